@@ -160,6 +160,11 @@ namespace reshade { namespace api
 		/// If this feature is not present, <see cref="command_list::copy_query_results"/> must not be used.
 		/// </summary>
 		copy_query_results,
+		/// <summary>
+		/// Specifies whether pipelines can be created from multiple threads concurrently, while the device is in use for rendering.
+		/// If this feature is not present, <see cref="device::create_pipeline"/> must only be called from the thread that is presenting.
+		/// </summary>
+		concurrent_pipeline_creation,
 	};
 
 	/// <summary>
@@ -25,6 +25,12 @@ struct draw_stats
 	uint32_t vertices = 0;
 	uint32_t drawcalls = 0;
 	float last_viewport[6] = {};
+
+	void add_counts(const draw_stats &other)
+	{
+		vertices += other.vertices;
+		drawcalls += other.drawcalls;
+	}
 };
 struct clear_stats : public draw_stats
 {
@@ -48,6 +54,10 @@ struct state_tracking
 	resource current_depth_stencil = { 0 };
 	float current_viewport[6] = {};
 	std::unordered_map<uint64_t, depth_stencil_info> counters_per_used_depth_stencil;
+	// Counters of the current depth-stencil, which are looked up on the first draw call after it was bound (and after every reset) instead of on every draw call
+	depth_stencil_info *current_counters = nullptr;
+	// Set when the viewport has to be copied to the current counters on the next draw call
+	bool current_viewport_changed = true;
 
 	void reset()
 	{
@@ -60,12 +70,43 @@ struct state_tracking
 		first_empty_stats = true;
 		has_indirect_drawcalls = false;
 		counters_per_used_depth_stencil.clear();
+		current_counters = nullptr;
+	}
+
+	void set_current_depth_stencil(resource depth_stencil)
+	{
+		if (depth_stencil == current_depth_stencil)
+			return;
+
+		current_depth_stencil = depth_stencil;
+		current_counters = nullptr;
+	}
+
+	void add_draw_calls(uint32_t vertices, uint32_t drawcalls)
+	{
+		if (current_counters == nullptr)
+		{
+			current_counters = &counters_per_used_depth_stencil[current_depth_stencil.handle];
+			current_viewport_changed = true;
+		}
+
+		current_counters->total_stats.vertices += vertices;
+		current_counters->total_stats.drawcalls += drawcalls;
+		current_counters->current_stats.vertices += vertices;
+		current_counters->current_stats.drawcalls += drawcalls;
+
+		// The last viewport only changes when a new one is bound, so only need to copy it then
+		if (current_viewport_changed)
+		{
+			std::memcpy(current_counters->current_stats.last_viewport, current_viewport, 6 * sizeof(float));
+			current_viewport_changed = false;
+		}
 	}
 
 	void merge(const state_tracking &source)
 	{
 		// Executing a command list in a different command list inherits state
-		current_depth_stencil = source.current_depth_stencil;
+		set_current_depth_stencil(source.current_depth_stencil);
 
 		if (first_empty_stats)
 			first_empty_stats = source.first_empty_stats;
@@ -78,10 +119,8 @@ struct state_tracking
 		for (const auto &[depth_stencil_handle, snapshot] : source.counters_per_used_depth_stencil)
 		{
 			depth_stencil_info &target_snapshot = counters_per_used_depth_stencil[depth_stencil_handle];
-			target_snapshot.total_stats.vertices += snapshot.total_stats.vertices;
-			target_snapshot.total_stats.drawcalls += snapshot.total_stats.drawcalls;
-			target_snapshot.current_stats.vertices += snapshot.current_stats.vertices;
-			target_snapshot.current_stats.drawcalls += snapshot.current_stats.drawcalls;
+			target_snapshot.total_stats.add_counts(snapshot.total_stats);
+			target_snapshot.current_stats.add_counts(snapshot.current_stats);
 
 			target_snapshot.clears.insert(target_snapshot.clears.end(), snapshot.clears.begin(), snapshot.clears.end());
 
@@ -176,6 +215,9 @@ static void clear_depth_impl(command_list *cmd_list, state_tracking &state, cons
 
 	depth_stencil_info &counters = state.counters_per_used_depth_stencil[depth_stencil.handle];
 
+	// The stats below may be replaced, including the viewport, so copy it again on the next draw call
+	state.current_viewport_changed = true;
+
 	// Update stats with data from previous frame
 	if (!fullscreen_draw_call && counters.current_stats.drawcalls == 0 && state.first_empty_stats)
 	{
@@ -330,12 +372,7 @@ static bool on_draw(command_list *cmd_list, uint32_t vertices, uint32_t instance
 	}
 #endif
 
-	depth_stencil_info &counters = state.counters_per_used_depth_stencil[state.current_depth_stencil.handle];
-	counters.total_stats.vertices += vertices * instances;
-	counters.total_stats.drawcalls += 1;
-	counters.current_stats.vertices += vertices * instances;
-	counters.current_stats.drawcalls += 1;
-	std::memcpy(counters.current_stats.last_viewport, state.current_viewport, 6 * sizeof(float));
+	state.add_draw_calls(vertices * instances, 1);
 
 	return false;
 }
@@ -349,10 +386,10 @@ static bool on_draw_indirect(command_list *cmd_list, uint32_t type, resource, ui
 {
 	if (type != 3)
 	{
-		for (uint32_t i = 0; i < draw_count; ++i)
-			on_draw(cmd_list, 0, 0, 0, 0);
-
 		auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
+		if (state.current_depth_stencil != 0 && draw_count != 0)
+			state.add_draw_calls(0, draw_count);
+
 		state.has_indirect_drawcalls = true;
 	}
 
@@ -365,6 +402,7 @@ static void on_bind_viewport(command_list *cmd_list, uint32_t first, uint32_t co
 
 	auto &state = cmd_list->get_user_data<state_tracking>(state_tracking::GUID);
 	std::memcpy(state.current_viewport, viewport, 6 * sizeof(float));
+	state.current_viewport_changed = true;
 }
 static void on_bind_depth_stencil(command_list *cmd_list, uint32_t, const resource_view *, resource_view dsv)
 {
@@ -383,7 +421,7 @@ static void on_bind_depth_stencil(command_list *cmd_list, uint32_t, const resour
 		clear_depth_impl(cmd_list, state, device->get_user_data<state_tracking_context>(state_tracking_context::GUID), state.current_depth_stencil, true);
 	}
 
-	state.current_depth_stencil = depth_stencil;
+	state.set_current_depth_stencil(depth_stencil);
 }
 static bool on_clear_depth_stencil(command_list *cmd_list, resource_view dsv, uint32_t clear_flags, float, uint8_t)
 {
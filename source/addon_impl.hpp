@@ -5,11 +5,91 @@
 
 #pragma once
 
+#include <mutex>
+#include <atomic>
 #include <string>
 #include <vector>
 
 namespace reshade::api
 {
+	/// <summary>
+	/// Process-wide assignment of the GUIDs passed to <see cref="api_object::get_user_data"/> and <see cref="api_object::set_user_data"/> to fixed slots, so that objects can store their user data in an array indexed by slot.
+	/// A GUID is assigned a slot the first time data is stored with it and keeps that slot forever. Once all slots are taken, further GUIDs are stored in a list per object instead.
+	/// </summary>
+	class user_data_slots
+	{
+	public:
+		static constexpr uint32_t MAX_SLOTS = 16;
+
+		/// <summary>
+		/// Gets the slot assigned to the specified <paramref name="guid"/>.
+		/// This is lock-free, unless a new slot has to be assigned.
+		/// </summary>
+		/// <param name="guid">The GUID to look up.</param>
+		/// <param name="assign">Set to <c>true</c> to assign a new slot if the GUID does not have one yet.</param>
+		/// <returns>The slot index, or <see cref="MAX_SLOTS"/> if the GUID has no slot.</returns>
+		static uint32_t find(const uint8_t guid[16], bool assign)
+		{
+			const uint64_t guid_lo = reinterpret_cast<const uint64_t *>(guid)[0];
+			const uint64_t guid_hi = reinterpret_cast<const uint64_t *>(guid)[1];
+
+			if (const uint32_t slot = lookup(guid_lo, guid_hi); slot != MAX_SLOTS || !assign)
+				return slot;
+
+			static std::mutex s_mutex;
+			const std::lock_guard<std::mutex> lock(s_mutex);
+
+			// Another thread may have assigned a slot in the meantime
+			if (const uint32_t slot = lookup(guid_lo, guid_hi); slot != MAX_SLOTS)
+				return slot;
+
+			static uint32_t s_num_slots = 0;
+			if (s_num_slots == MAX_SLOTS)
+				return MAX_SLOTS;
+
+			// There are always more entries than slots, so this finds an empty entry
+			uint32_t i = hash(guid_lo, guid_hi);
+			while (s_entries[i].slot.load(std::memory_order_relaxed) != 0)
+				i = (i + 1) % NUM_ENTRIES;
+
+			s_entries[i].guid[0].store(guid_lo, std::memory_order_relaxed);
+			s_entries[i].guid[1].store(guid_hi, std::memory_order_relaxed);
+			s_entries[i].slot.store(++s_num_slots, std::memory_order_release);
+
+			return s_num_slots - 1;
+		}
+
+	private:
+		static constexpr uint32_t NUM_ENTRIES = MAX_SLOTS * 4;
+
+		struct entry
+		{
+			std::atomic<uint64_t> guid[2];
+			std::atomic<uint32_t> slot; // Slot index plus one, or zero if the entry is empty
+		};
+
+		static uint32_t hash(uint64_t guid_lo, uint64_t guid_hi)
+		{
+			return static_cast<uint32_t>((guid_lo ^ (guid_hi * 0x9e3779b97f4a7c15ull)) >> 32) % NUM_ENTRIES;
+		}
+
+		static uint32_t lookup(uint64_t guid_lo, uint64_t guid_hi)
+		{
+			// Entries are never removed, so the probe sequence ends at the first empty entry
+			for (uint32_t i = hash(guid_lo, guid_hi);; i = (i + 1) % NUM_ENTRIES)
+			{
+				const uint32_t slot = s_entries[i].slot.load(std::memory_order_acquire);
+				if (slot == 0)
+					return MAX_SLOTS;
+				if (s_entries[i].guid[0].load(std::memory_order_relaxed) == guid_lo &&
+					s_entries[i].guid[1].load(std::memory_order_relaxed) == guid_hi)
+					return slot - 1;
+			}
+		}
+
+		static inline entry s_entries[NUM_ENTRIES] = {};
+	};
+
 	template <typename T, typename... api_object_base>
 	class api_object_impl : public api_object_base...
 	{
@@ -21,6 +101,12 @@ namespace reshade::api
 
 		bool get_user_data(const uint8_t guid[16], void **ptr) const override
 		{
+			if (const uint32_t slot = user_data_slots::find(guid, false); slot != user_data_slots::MAX_SLOTS)
+			{
+				*ptr = _data_slots[slot];
+				return *ptr != nullptr;
+			}
+
 			for (auto it = _data_entries.begin(); it != _data_entries.end(); ++it)
 			{
 				if (it->guid[0] == reinterpret_cast<const uint64_t *>(guid)[0] &&
@@ -34,6 +120,12 @@ namespace reshade::api
 		}
 		void set_user_data(const uint8_t guid[16], void * const ptr) override
 		{
+			if (const uint32_t slot = user_data_slots::find(guid, ptr != nullptr); slot != user_data_slots::MAX_SLOTS)
+			{
+				_data_slots[slot] = ptr;
+				return;
+			}
+
 			for (auto it = _data_entries.begin(); it != _data_entries.end(); ++it)
 			{
 				if (it->guid[0] == reinterpret_cast<const uint64_t *>(guid)[0] &&
@@ -66,6 +158,8 @@ namespace reshade::api
 			uint64_t guid[2];
 		};
 
+		void *_data_slots[user_data_slots::MAX_SLOTS] = {};
+		// Only used for GUIDs that did not get a slot
 		std::vector<entry> _data_entries;
 	};
 }
@@ -12,12 +12,22 @@
 
 bool g_addons_enabled = true;
 std::vector<void *> reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::max)];
+std::atomic<uint64_t> reshade::addon::event_mask[(static_cast<uint32_t>(reshade::addon_event::max) + 63) / 64] = {};
 std::vector<reshade::addon::info> reshade::addon::loaded_info;
 #if RESHADE_GUI
 std::vector<std::pair<std::string, void(*)(reshade::api::effect_runtime *, void *)>> reshade::addon::overlay_list;
 #endif
 static unsigned long s_reference_count = 0;
 
+static void update_event_mask(size_t event_index)
+{
+	const uint64_t event_bit = 1ull << (event_index % 64);
+	if (reshade::addon::event_list[event_index].empty())
+		reshade::addon::event_mask[event_index / 64].fetch_and(~event_bit, std::memory_order_relaxed);
+	else
+		reshade::addon::event_mask[event_index / 64].fetch_or(event_bit, std::memory_order_relaxed);
+}
+
 extern void register_builtin_addon_depth(reshade::addon::info &info);
 extern void unregister_builtin_addon_depth();
 
@@ -162,12 +172,18 @@ void reshade::addon::enable_or_disable_addons(bool enabled)
 	if (enabled)
 	{
 		for (size_t event_index = 0; event_index < std::size(event_list); ++event_index)
+		{
 			event_list[event_index] = std::move(disabled_event_list[event_index]);
+			update_event_mask(event_index);
+		}
 	}
 	else
 	{
 		for (size_t event_index = 0; event_index < std::size(event_list); ++event_index)
+		{
 			disabled_event_list[event_index] = std::move(event_list[event_index]);
+			update_event_mask(event_index);
+		}
 	}
 
 	g_addons_enabled = enabled;
@@ -177,6 +193,7 @@ extern "C" __declspec(dllexport) void ReShadeRegisterEvent(reshade::addon_event
 {
 	auto &event_list = reshade::addon::event_list[static_cast<size_t>(ev)];
 	event_list.push_back(callback);
+	update_event_mask(static_cast<size_t>(ev));
 
 #if RESHADE_VERBOSE_LOG
 	LOG(DEBUG) << "Registered event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
@@ -186,6 +203,7 @@ extern "C" __declspec(dllexport) void ReShadeUnregisterEvent(reshade::addon_even
 {
 	auto &event_list = reshade::addon::event_list[static_cast<size_t>(ev)];
 	event_list.erase(std::remove(event_list.begin(), event_list.end(), callback), event_list.end());
+	update_event_mask(static_cast<size_t>(ev));
 
 #if RESHADE_VERBOSE_LOG
 	LOG(DEBUG) << "Unregistered event callback " << callback << " for event " << addon_event_to_string(ev) << '.';
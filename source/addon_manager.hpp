@@ -7,6 +7,7 @@
 
 #include "addon_impl.hpp"
 #include "reshade_events.hpp"
+#include <atomic>
 
 #if RESHADE_ADDON
 
@@ -35,20 +36,47 @@ namespace reshade
 					return static_cast<addon_event_call_chain &>(call_chain).terminator_data(std::forward<Args>(args)...);
 				});
 		}
+
+		static R call_terminator(F &terminator, Args... args)
+		{
+			return terminator(std::forward<Args>(args)...);
+		}
 	};
 
+	/// <summary>
+	/// Checks whether any callbacks are installed for the specified event, so that hooks can skip preparing the arguments for it entirely when there are none.
+	/// </summary>
+	template <addon_event ev>
+	inline bool has_addon_event()
+	{
+		return (addon::event_mask[static_cast<size_t>(ev) / 64].load(std::memory_order_relaxed) & (1ull << (static_cast<size_t>(ev) % 64))) != 0;
+	}
+
 	template <addon_event ev, typename... Args>
 	inline std::enable_if_t<addon_event_traits<ev>::type == 1, void> invoke_addon_event(Args... args)
 	{
+		if (!has_addon_event<ev>())
+			return;
+
 		std::vector<void *> &event_list = addon::event_list[static_cast<size_t>(ev)];
+		// Most events only have a single add-on listening, which can be called directly
+		if (event_list.size() == 1)
+			return reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[0])(std::forward<Args>(args)...);
+
 		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb) // Generates better code than ranged-based for loop
 			reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...);
 	}
 	template <addon_event ev, typename... Args>
 	inline std::enable_if_t<addon_event_traits<ev>::type == 2, bool> invoke_addon_event(Args... args)
 	{
-		bool skip = false;
+		if (!has_addon_event<ev>())
+			return false;
+
 		std::vector<void *> &event_list = addon::event_list[static_cast<size_t>(ev)];
+		if (event_list.size() == 1)
+			return reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[0])(std::forward<Args>(args)...);
+
+		bool skip = false;
 		for (size_t cb = 0, count = event_list.size(); cb < count; ++cb)
 			skip |= reinterpret_cast<typename reshade::addon_event_traits<ev>::decl>(event_list[cb])(std::forward<Args>(args)...);
 		return skip;
@@ -56,6 +84,10 @@ namespace reshade
 	template <addon_event ev, typename F, typename... Args>
 	inline std::enable_if_t< addon_event_traits<ev>::type == 3, void> invoke_addon_event(F &&terminator, Args... args)
 	{
+		// Call the original function directly if there is no call chain to go through
+		if (!has_addon_event<ev>())
+			return (void)addon_event_call_chain<ev, F>::call_terminator(terminator, std::forward<Args>(args)...);
+
 		addon_event_call_chain<ev, F>(std::move(terminator))(std::forward<Args>(args)...);
 	}
 }
@@ -78,6 +110,10 @@ namespace reshade::addon
 	/// List of installed add-on event callbacks.
 	/// </summary>
 	extern std::vector<void *> event_list[];
+	/// <summary>
+	/// Bit mask of all events that have at least one callback installed in <see cref="event_list"/> (bit N of the mask is set for event N).
+	/// </summary>
+	extern std::atomic<uint64_t> event_mask[];
 
 #if RESHADE_GUI
 	/// <summary>
@@ -36,7 +36,7 @@ void D3D10Device::invoke_bind_render_targets_event(UINT count, ID3D10RenderTarge
 	assert(count <= D3D10_SIMULTANEOUS_RENDER_TARGET_COUNT);
 
 	if ((count == 0 && dsv == nullptr) ||
-		reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::begin_render_pass)].empty())
+		!reshade::has_addon_event<reshade::addon_event::begin_render_pass>())
 		return;
 
 #ifndef WIN64
@@ -55,7 +55,7 @@ void D3D10Device::invoke_bind_vertex_buffers_event(UINT first, UINT count, ID3D1
 {
 	assert(count <= D3D10_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_vertex_buffers)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
 #ifndef WIN64
@@ -77,7 +77,7 @@ void D3D10Device::invoke_bind_samplers_event(reshade::api::shader_stage stage, U
 {
 	assert(count <= D3D10_COMMONSHADER_SAMPLER_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -95,7 +95,7 @@ void D3D10Device::invoke_bind_shader_resource_views_event(reshade::api::shader_s
 {
 	assert(count <= D3D10_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -113,7 +113,7 @@ void D3D10Device::invoke_bind_constant_buffers_event(reshade::api::shader_stage
 {
 	assert(count <= D3D10_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -403,7 +403,7 @@ void    STDMETHODCALLTYPE D3D10Device::RSSetViewports(UINT NumViewports, const D
 #if RESHADE_ADDON
 	assert(NumViewports <= D3D10_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_viewports)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_viewports>())
 		return;
 
 	float viewport_data[6 * D3D10_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
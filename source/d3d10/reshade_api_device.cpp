@@ -65,6 +65,8 @@ bool reshade::d3d10::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_results:
 		return false;
+	case api::device_caps::concurrent_pipeline_creation:
+		return false; // The application may have created the device with 'D3D10_CREATE_DEVICE_SINGLETHREADED'
 	default:
 		return false;
 	}
@@ -83,7 +83,7 @@ void D3D11DeviceContext::invoke_bind_render_targets_event(UINT count, ID3D11Rend
 	assert(count <= D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT);
 
 	if ((count == 0 && dsv == nullptr) ||
-		reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::begin_render_pass)].empty())
+		!reshade::has_addon_event<reshade::addon_event::begin_render_pass>())
 		return;
 
 #ifndef WIN64
@@ -102,7 +102,7 @@ void D3D11DeviceContext::invoke_bind_vertex_buffers_event(UINT first, UINT count
 {
 	assert(count <= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::bind_vertex_buffers)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::bind_vertex_buffers>())
 		return;
 
 #ifndef WIN64
@@ -124,7 +124,7 @@ void D3D11DeviceContext::invoke_bind_samplers_event(reshade::api::shader_stage s
 {
 	assert(count <= D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -142,7 +142,7 @@ void D3D11DeviceContext::invoke_bind_shader_resource_views_event(reshade::api::s
 {
 	assert(count <= D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -160,7 +160,7 @@ void D3D11DeviceContext::invoke_bind_unordered_access_views_event(reshade::api::
 {
 	assert(count <= D3D11_1_UAV_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
@@ -178,7 +178,7 @@ void D3D11DeviceContext::invoke_bind_constant_buffers_event(reshade::api::shader
 {
 	assert(count <= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
 
-	if (reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::push_descriptors)].empty())
+	if (!reshade::has_addon_event<reshade::addon_event::push_descriptors>())
 		return;
 
 #ifndef WIN64
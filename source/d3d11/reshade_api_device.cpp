@@ -70,6 +70,8 @@ bool reshade::d3d11::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_results:
 		return false;
+	case api::device_caps::concurrent_pipeline_creation:
+		return (_orig->GetCreationFlags() & D3D11_CREATE_DEVICE_SINGLETHREADED) == 0;
 	default:
 		return false;
 	}
@@ -29,7 +29,7 @@ namespace reshade::d3d11
 
 		bool capture_screenshot(uint8_t *buffer) const final;
 
-		bool compile_effect(effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso) final;
+		bool compile_effect(const effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors) final;
 
 		api::resource_view get_backbuffer(bool srgb) final { return { reinterpret_cast<uintptr_t>(_backbuffer_rtv[srgb ? 1 : 0].get()) }; }
 		api::resource get_backbuffer_resource() final { return { (uintptr_t)_backbuffer_resolved.get() }; }
@@ -55,6 +55,7 @@ namespace reshade::d3d11
 		com_ptr<ID3D11ShaderResourceView> _backbuffer_texture_srv;
 
 		HMODULE _d3d_compiler = nullptr;
+		std::mutex _d3d_compiler_mutex;
 		com_ptr<ID3D11RasterizerState> _effect_rasterizer;
 	};
 }
@@ -146,6 +146,8 @@ bool reshade::d3d12::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_results:
 		return true;
+	case api::device_caps::concurrent_pipeline_creation:
+		return true;
 	default:
 		return false;
 	}
@@ -182,8 +184,7 @@ bool reshade::d3d12::device_impl::is_resource_handle_valid(api::resource handle)
 }
 bool reshade::d3d12::device_impl::is_resource_view_handle_valid(api::resource_view handle) const
 {
-	const std::lock_guard<std::mutex> lock(_mutex);
-	return _views.find(handle.handle) != _views.end();
+	return handle.handle != 0 && _views.find(handle.handle);
 }
 
 bool reshade::d3d12::device_impl::create_sampler(const api::sampler_desc &desc, api::sampler *out)
@@ -720,9 +721,10 @@ void reshade::d3d12::device_impl::destroy_resource_view(api::resource_view handl
 	if (handle.handle == 0)
 		return;
 
-	const std::lock_guard<std::mutex> lock(_mutex);
 	_views.erase(handle.handle);
 
+	const std::lock_guard<std::mutex> lock(_mutex);
+
 	for (UINT i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
 		_view_heaps[i].deallocate({ static_cast<SIZE_T>(handle.handle) });
 }
@@ -943,9 +945,8 @@ void reshade::d3d12::device_impl::get_resource_from_view(api::resource_view view
 {
 	assert(view.handle != 0);
 
-	const std::lock_guard<std::mutex> lock(_mutex);
-	if (const auto it = _views.find(view.handle); it != _views.end())
-		*out_resource = { reinterpret_cast<uintptr_t>(it->second) };
+	if (ID3D12Resource *resource; _views.try_get(view.handle, resource))
+		*out_resource = { reinterpret_cast<uintptr_t>(resource) };
 	else
 		*out_resource = { 0 };
 }
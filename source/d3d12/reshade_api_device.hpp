@@ -8,6 +8,7 @@
 #include "com_tracking.hpp"
 #include "addon_manager.hpp"
 #include "descriptor_heap.hpp"
+#include "object_registry.hpp"
 #include <dxgi1_5.h>
 #include <unordered_map>
 
@@ -112,7 +113,6 @@ namespace reshade::d3d12
 		inline void register_resource_view(ID3D12Resource *resource, D3D12_CPU_DESCRIPTOR_HANDLE handle)
 		{
 			assert(resource != nullptr);
-			const std::lock_guard<std::mutex> lock(_mutex);
 			_views.emplace(handle.ptr, resource);
 		}
 #if RESHADE_ADDON
@@ -125,6 +125,6 @@ namespace reshade::d3d12
 #endif
 
 		com_object_list<ID3D12Resource> _resources;
-		std::unordered_map<uint64_t, ID3D12Resource *> _views;
+		object_registry<uint64_t, ID3D12Resource *> _views;
 	};
 }
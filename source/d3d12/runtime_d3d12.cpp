@@ -431,19 +431,26 @@ bool reshade::d3d12::runtime_impl::capture_screenshot(uint8_t *buffer) const
 	return true;
 }
 
-bool reshade::d3d12::runtime_impl::compile_effect(effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso)
+bool reshade::d3d12::runtime_impl::compile_effect(const effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors)
 {
-	if (_d3d_compiler == nullptr)
-		_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+	HMODULE d3d_compiler;
+	{	// Entry points are compiled in parallel, so make sure the compiler library is only loaded once
+		const std::lock_guard<std::mutex> lock(_d3d_compiler_mutex);
 
-	if (_d3d_compiler == nullptr)
+		if (_d3d_compiler == nullptr)
+			_d3d_compiler = LoadLibraryW(L"d3dcompiler_47.dll");
+
+		d3d_compiler = _d3d_compiler;
+	}
+
+	if (d3d_compiler == nullptr)
 	{
 		LOG(ERROR) << "Unable to load HLSL compiler (\"d3dcompiler_47.dll\")!";
 		return false;
 	}
 
-	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(_d3d_compiler, "D3DCompile"));
-	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(_d3d_compiler, "D3DDisassemble"));
+	const auto D3DCompile = reinterpret_cast<pD3DCompile>(GetProcAddress(d3d_compiler, "D3DCompile"));
+	const auto D3DDisassemble = reinterpret_cast<pD3DDisassemble>(GetProcAddress(d3d_compiler, "D3DDisassemble"));
 
 	HRESULT hr = E_FAIL;
 	const std::string hlsl = effect.preamble + effect.module.hlsl;
@@ -473,20 +480,26 @@ bool reshade::d3d12::runtime_impl::compile_effect(effect &effect, api::shader_st
 	attributes += "profile=" + profile + ';';
 	attributes += "flags=" + std::to_string(compile_flags) + ';';
 
-	const size_t hash = std::hash<std::string_view>()(attributes) ^ std::hash<std::string_view>()(hlsl);
-	if (!load_effect_cache(effect.source_file, entry_point, hash, cso, effect.assembly[entry_point]))
+	// Code that is not referenced by this entry point is guarded by this define
+	const std::string entry_point_define = "ENTRY_POINT_" + entry_point;
+	const D3D_SHADER_MACRO defines[] = {
+		{ entry_point_define.c_str(), "1" }, { nullptr, nullptr }
+	};
+
+	const uint64_t hash = compute_cache_hash(effect, entry_point, attributes);
+	if (!load_effect_cache(effect.source_file, entry_point, hash, cso, assembly))
 	{
 		com_ptr<ID3DBlob> d3d_compiled, d3d_errors;
 		hr = D3DCompile(
 			hlsl.data(), hlsl.size(),
-			nullptr, nullptr, nullptr,
+			nullptr, defines, nullptr,
 			entry_point.c_str(),
 			profile.c_str(),
 			compile_flags, 0,
 			&d3d_compiled, &d3d_errors);
 
 		if (d3d_errors != nullptr) // Append warnings to the output error string as well
-			effect.errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
+			errors.append(static_cast<const char *>(d3d_errors->GetBufferPointer()), d3d_errors->GetBufferSize() - 1); // Subtracting one to not append the null-terminator as well
 
 		// No need to setup resources if any of the shaders failed to compile
 		if (FAILED(hr))
@@ -496,9 +509,9 @@ bool reshade::d3d12::runtime_impl::compile_effect(effect &effect, api::shader_st
 		std::memcpy(cso.data(), d3d_compiled->GetBufferPointer(), cso.size());
 
 		if (com_ptr<ID3DBlob> d3d_disassembled; SUCCEEDED(D3DDisassemble(cso.data(), cso.size(), 0, nullptr, &d3d_disassembled)))
-			effect.assembly[entry_point].assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
+			assembly.assign(static_cast<const char *>(d3d_disassembled->GetBufferPointer()), d3d_disassembled->GetBufferSize() - 1);
 
-		save_effect_cache(effect.source_file, entry_point, hash, cso, effect.assembly[entry_point]);
+		save_effect_cache(effect.source_file, entry_point, hash, cso, assembly);
 	}
 
 	return true;
@@ -251,6 +251,7 @@ bool reshade::d3d9::device_impl::check_capability(api::device_caps capability) c
 	case api::device_caps::resolve_region:
 		return true;
 	case api::device_caps::copy_query_results:
+	case api::device_caps::concurrent_pipeline_creation:
 	default:
 		return false;
 	}
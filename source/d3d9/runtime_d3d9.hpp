@@ -27,7 +27,7 @@ namespace reshade::d3d9
 
 		bool capture_screenshot(uint8_t *buffer) const final;
 
-		bool compile_effect(effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso) final;
+		bool compile_effect(const effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &cso, std::string &assembly, std::string &errors) final;
 
 		api::resource_view get_backbuffer(bool srgb) final { return { reinterpret_cast<uintptr_t>(_backbuffer_resolved.get()) | (srgb ? 1 : 0) }; }
 		api::resource get_backbuffer_resource() final { return { reinterpret_cast<uintptr_t>(_backbuffer_resolved.get()) }; }
@@ -44,5 +44,6 @@ namespace reshade::d3d9
 		com_ptr<IDirect3DSurface9> _backbuffer_resolved;
 
 		HMODULE _d3d_compiler = nullptr;
+		std::mutex _d3d_compiler_mutex;
 	};
 }
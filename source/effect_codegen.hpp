@@ -7,6 +7,7 @@
 
 #include "effect_module.hpp"
 #include <memory> // std::unique_ptr
+#include <memory_resource>
 #include <algorithm> // std::find_if
 
 namespace reshadefx
@@ -100,6 +101,17 @@ namespace reshadefx
 		/// <param name="type">The shader type (vertex, pixel or compute shader).</param>
 		/// <param name="num_threads">The number of local threads it this is a compute entry point.</param>
 		virtual void define_entry_point(function_info &function, shader_type type, int num_threads[3] = nullptr) = 0;
+		/// <summary>
+		/// Set the hash of the source code an entry point is generated from, which is only known once all code was parsed.
+		/// </summary>
+		/// <param name="name">The unique name of the entry point.</param>
+		/// <param name="hash">The hash value to store in <see cref="entry_point::source_hash"/>.</param>
+		void set_entry_point_source_hash(const std::string &name, uint64_t hash)
+		{
+			if (const auto it = std::find_if(_module.entry_points.begin(), _module.entry_points.end(),
+				[&name](const auto &ep) { return ep.name == name; }); it != _module.entry_points.end())
+				it->source_hash = hash;
+		}
 
 		/// <summary>
 		/// Resolve the access chain and add a load operation to the output.
@@ -195,6 +207,11 @@ namespace reshadefx
 		/// <param name="flags">0 - default, 1 - flatten, 2 - do not flatten</param>
 		virtual void emit_if(const location &loc, id condition_value, id condition_block, id true_statement_block, id false_statement_block, unsigned int flags) = 0;
 		/// <summary>
+		/// Add a block of statements that is always executed to the output, as is the case for the taken branch of an if statement with a constant condition.
+		/// </summary>
+		/// <param name="loc">Source location matching the statements (for debugging).</param>
+		virtual void emit_block(const location &loc, id prev_block, id statement_block) = 0;
+		/// <summary>
 		/// Add a branch control flow with a SSA phi operation to the output.
 		/// </summary>
 		/// <param name="loc">Source location matching this branch (for debugging).</param>
@@ -329,6 +346,11 @@ namespace reshadefx
 			return align_up(size, alignment) * (elements - 1) + size;
 		}
 
+		// Data structures of the implementations allocate from this arena, which releases all of it in one go when the code generator is destroyed
+		// It is declared before any of them, so that it outlives them all. The pool on top recycles blocks that were freed during code generation already.
+		std::pmr::monotonic_buffer_resource _arena_buffer;
+		std::pmr::unsynchronized_pool_resource _arena { &_arena_buffer };
+
 		reshadefx::module _module;
 		std::vector<struct_info> _structs;
 		std::vector<std::unique_ptr<function_info>> _functions;
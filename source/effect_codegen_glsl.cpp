@@ -5,6 +5,7 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_codegen_text.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
@@ -19,9 +20,8 @@ public:
 	codegen_glsl(bool debug_info, bool uniforms_to_spec_constants, bool enable_16bit_types, bool flip_vert_y)
 		: _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants), _enable_16bit_types(enable_16bit_types), _flip_vert_y(flip_vert_y)
 	{
-		// Create default block and reserve a memory block to avoid frequent reallocations
-		std::string &block = _blocks.emplace(0, std::string()).first->second;
-		block.reserve(8192);
+		// Create default block
+		_blocks.try_emplace(0);
 	}
 
 private:
@@ -37,10 +37,11 @@ private:
 		expression,
 	};
 
-	std::string _ubo_block;
-	std::string _compute_block;
+	std::pmr::string _ubo_block { &_arena };
+	std::pmr::string _compute_block { &_arena };
 	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::pmr::unordered_map<id, text_block> _blocks { &_arena };
+	entry_point_guards _entry_point_guards;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	bool _enable_16bit_types = false;
@@ -100,11 +101,13 @@ private:
 			// TODO: This technically only works with square matrices
 			module.hlsl += "layout(std140, column_major, binding = 0) uniform _Globals {\n" + _ubo_block + "};\n";
 
-		module.hlsl += _blocks.at(0);
+		_entry_point_guards.write_conditions(module.entry_points.size());
+
+		_blocks.at(0).write(module.hlsl);
 	}
 
-	template <bool is_param = false, bool is_decl = true, bool is_interface = false>
-	void write_type(std::string &s, const type &type) const
+	template <bool is_param = false, bool is_decl = true, bool is_interface = false, typename string_type>
+	void write_type(string_type &s, const type &type) const
 	{
 		if constexpr (is_decl)
 		{
@@ -226,7 +229,8 @@ private:
 			assert(false);
 		}
 	}
-	void write_constant(std::string &s, const type &type, const constant &data) const
+	template <typename string_type>
+	void write_constant(string_type &s, const type &type, const constant &data) const
 	{
 		if (type.is_array())
 		{
@@ -294,7 +298,8 @@ private:
 		if (!type.is_scalar())
 			s += ')';
 	}
-	void write_location(std::string &s, const location &loc) const
+	template <typename string_type>
+	void write_location(string_type &s, const location &loc) const
 	{
 		if (loc.source.empty() || !_debug_info)
 			return;
@@ -423,10 +428,19 @@ private:
 		if (block.empty())
 			return;
 
-		for (size_t pos = 0; (pos = block.find("\n\t", pos)) != std::string::npos; pos += 3)
-			block.replace(pos, 2, "\n\t\t");
+		std::string result;
+		result.reserve(block.size() + std::count(block.begin(), block.end(), '\n') + 1);
+		result += '\t';
+
+		for (size_t i = 0; i < block.size(); ++i)
+		{
+			result += block[i];
+
+			if (block[i] == '\n' && i + 1 < block.size() && block[i + 1] == '\t')
+				result += '\t';
+		}
 
-		block.insert(block.begin(), '\t');
+		block = std::move(result);
 	}
 
 	id   define_struct(const location &loc, struct_info &info) override
@@ -436,7 +450,7 @@ private:
 
 		_structs.push_back(info);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -477,12 +491,16 @@ private:
 
 		define_name<naming::unique>(info.id, info.unique_name);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
+
+		_entry_point_guards.begin(code, info.id);
 
 		write_location(code, loc);
 
 		code += "layout(binding = " + std::to_string(info.binding) + ") uniform sampler2D " + id_to_name(info.id) + ";\n";
 
+		_entry_point_guards.end(code, info.id);
+
 		_module.samplers.push_back(info);
 
 		return info.id;
@@ -494,12 +512,16 @@ private:
 
 		define_name<naming::unique>(info.id, info.unique_name);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
+
+		_entry_point_guards.begin(code, info.id);
 
 		write_location(code, loc);
 
 		code += "layout(binding = " + std::to_string(info.binding) + ") uniform writeonly image2D " + id_to_name(info.id) + ";\n";
 
+		_entry_point_guards.end(code, info.id);
+
 		_module.storages.push_back(info);
 
 		return info.id;
@@ -516,7 +538,7 @@ private:
 			if (info.type.is_array())
 				info.size *= info.type.array_length;
 
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			write_location(code, loc);
 
@@ -586,7 +608,7 @@ private:
 		if (!name.empty())
 			define_name<naming::general>(res, name);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -623,7 +645,11 @@ private:
 		else
 			define_name<naming::reserved>(info.definition, "main");
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
+
+		// Entry point functions are already guarded as a whole
+		if (!is_entry_point)
+			_entry_point_guards.begin(code, info.definition);
 
 		write_location(code, loc);
 
@@ -674,6 +700,8 @@ private:
 
 		_module.entry_points.push_back({ func.unique_name, stype });
 
+		_entry_point_guards.add_entry_point(func.unique_name, func);
+
 		_blocks.at(0) += "#ifdef ENTRY_POINT_" + func.unique_name + '\n';
 		if (stype == shader_type::cs)
 			_blocks.at(0) += "layout(local_size_x = " + std::to_string(num_threads[0]) +
@@ -701,7 +729,7 @@ private:
 			if (type.base == type::t_bool)
 				type.base  = type::t_float;
 
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			const int array_length = std::max(1, type.array_length);
 			const uint32_t location = semantic_to_location(semantic, array_length);
@@ -776,7 +804,7 @@ private:
 		define_function({}, entry_point, true);
 		enter_block(create_block());
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		// Handle input parameters
 		for (size_t i = 0; i < num_params; ++i)
@@ -1094,7 +1122,7 @@ private:
 		if (force_new_id)
 		{
 			// Need to store value in a new variable to comply with request for a new ID
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			code += '\t';
 			write_type(code, exp.type);
@@ -1118,7 +1146,7 @@ private:
 			return;
 		}
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, exp.location);
 
@@ -1181,7 +1209,7 @@ private:
 
 		if (type.is_array() || type.is_struct())
 		{
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			code += '\t';
 
@@ -1217,7 +1245,7 @@ private:
 	{
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1251,7 +1279,7 @@ private:
 	{
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1382,7 +1410,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1412,7 +1440,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1452,7 +1480,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1491,7 +1519,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1528,13 +1556,13 @@ private:
 	{
 		assert(condition_value != 0 && condition_block != 0 && true_statement_block != 0 && false_statement_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
-		std::string &true_statement_data = _blocks.at(true_statement_block);
-		std::string &false_statement_data = _blocks.at(false_statement_block);
+		text_block &true_statement_data = _blocks.at(true_statement_block);
+		text_block &false_statement_data = _blocks.at(false_statement_block);
 
-		increase_indentation_level(true_statement_data);
-		increase_indentation_level(false_statement_data);
+		true_statement_data.increase_indentation_level();
+		false_statement_data.increase_indentation_level();
 
 		code += _blocks.at(condition_block);
 
@@ -1565,23 +1593,37 @@ private:
 			code += false_statement_data;
 			code += "\t}\n";
 		}
+	}
+	void emit_block(const location &loc, id prev_block, id statement_block) override
+	{
+		assert(prev_block != 0 && statement_block != 0);
+
+		text_block &code = _blocks.at(_current_block);
+
+		text_block &statement_data = _blocks.at(statement_block);
 
-		// Remove consumed blocks to save memory
-		_blocks.erase(condition_block);
-		_blocks.erase(true_statement_block);
-		_blocks.erase(false_statement_block);
+		statement_data.increase_indentation_level();
+
+		code += _blocks.at(prev_block);
+
+		write_location(code, loc);
+
+		// Keep the braces, so that variables declared in the statements stay in their own scope
+		code += "\t{\n";
+		code += statement_data;
+		code += "\t}\n";
 	}
 	id   emit_phi(const location &loc, id condition_value, id condition_block, id true_value, id true_statement_block, id false_value, id false_statement_block, const type &type) override
 	{
 		assert(condition_value != 0 && condition_block != 0 && true_value != 0 && true_statement_block != 0 && false_value != 0 && false_statement_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
-		std::string &true_statement_data = _blocks.at(true_statement_block);
-		std::string &false_statement_data = _blocks.at(false_statement_block);
+		text_block &true_statement_data = _blocks.at(true_statement_block);
+		text_block &false_statement_data = _blocks.at(false_statement_block);
 
-		increase_indentation_level(true_statement_data);
-		increase_indentation_level(false_statement_data);
+		true_statement_data.increase_indentation_level();
+		false_statement_data.increase_indentation_level();
 
 		const id res = make_id();
 
@@ -1594,32 +1636,32 @@ private:
 		write_location(code, loc);
 
 		code += "\tif (" + id_to_name(condition_value) + ")\n\t{\n";
-		code += (true_statement_block != condition_block ? true_statement_data : std::string());
+		if (true_statement_block != condition_block)
+			code += true_statement_data;
 		code += "\t\t" + id_to_name(res) + " = " + id_to_name(true_value) + ";\n";
 		code += "\t}\n\telse\n\t{\n";
-		code += (false_statement_block != condition_block ? false_statement_data : std::string());
+		if (false_statement_block != condition_block)
+			code += false_statement_data;
 		code += "\t\t" + id_to_name(res) + " = " + id_to_name(false_value) + ";\n";
 		code += "\t}\n";
 
-		// Remove consumed blocks to save memory
-		_blocks.erase(condition_block);
-		_blocks.erase(true_statement_block);
-		_blocks.erase(false_statement_block);
-
 		return res;
 	}
 	void emit_loop(const location &loc, id condition_value, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int flags) override
 	{
 		assert(prev_block != 0 && header_block != 0 && loop_block != 0 && continue_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
-		std::string &loop_data = _blocks.at(loop_block);
-		std::string &continue_data = _blocks.at(continue_block);
+		text_block &loop_data = _blocks.at(loop_block);
+		text_block &continue_block_data = _blocks.at(continue_block);
 
-		increase_indentation_level(loop_data);
-		increase_indentation_level(loop_data);
-		increase_indentation_level(continue_data);
+		loop_data.increase_indentation_level();
+		loop_data.increase_indentation_level();
+		continue_block_data.increase_indentation_level();
+
+		// The continue block is modified below, so need a copy of its code
+		std::string continue_data = continue_block_data.str();
 
 		code += _blocks.at(prev_block);
 
@@ -1649,9 +1691,7 @@ private:
 			continue_data.erase(pos_prev_assign + 1, pos_assign - pos_prev_assign - 1);
 
 			// We need to add the continue block to all "continue" statements as well
-			const std::string continue_id = "__CONTINUE__" + std::to_string(continue_block);
-			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
-				loop_data.replace(offset, continue_id.size(), continue_data);
+			continue_block_data.set_continue_substitution(continue_data, code);
 
 			code += "\tbool " + condition_name + ";\n";
 
@@ -1667,7 +1707,7 @@ private:
 		}
 		else
 		{
-			std::string &condition_data = _blocks.at(condition_block);
+			std::string condition_data = _blocks.at(condition_block).str();
 
 			// If the condition data is just a single line, then it is a simple expression, which we can just put into the loop condition as-is
 			if (std::count(condition_data.begin(), condition_data.end(), '\n') == 1)
@@ -1693,9 +1733,7 @@ private:
 				condition_data.erase(pos_prev_assign + 1, pos_assign - pos_prev_assign - 1);
 			}
 
-			const std::string continue_id = "__CONTINUE__" + std::to_string(continue_block);
-			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
-				loop_data.replace(offset, continue_id.size(), continue_data + condition_data);
+			continue_block_data.set_continue_substitution(continue_data + condition_data, code);
 
 			code += attributes;
 			code += '\t';
@@ -1705,22 +1743,14 @@ private:
 			code += continue_data;
 			code += condition_data;
 			code += "\t}\n";
-
-			_blocks.erase(condition_block);
 		}
-
-		// Remove consumed blocks to save memory
-		_blocks.erase(prev_block);
-		_blocks.erase(header_block);
-		_blocks.erase(loop_block);
-		_blocks.erase(continue_block);
 	}
 	void emit_switch(const location &loc, id selector_value, id selector_block, id default_label, id default_block, const std::vector<id> &case_literal_and_labels, const std::vector<id> &case_blocks, unsigned int) override
 	{
 		assert(selector_value != 0 && selector_block != 0 && default_label != 0 && default_block != 0);
 		assert(case_blocks.size() == case_literal_and_labels.size() / 2);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += _blocks.at(selector_block);
 
@@ -1754,9 +1784,9 @@ private:
 			}
 
 			assert(case_blocks[i / 2] != 0);
-			std::string &case_data = _blocks.at(case_blocks[i / 2]);
+			text_block &case_data = _blocks.at(case_blocks[i / 2]);
 
-			increase_indentation_level(case_data);
+			case_data.increase_indentation_level();
 
 			code += "{\n";
 			code += case_data;
@@ -1766,32 +1796,23 @@ private:
 
 		if (default_label != 0 && default_block != _current_block)
 		{
-			std::string &default_data = _blocks.at(default_block);
+			text_block &default_data = _blocks.at(default_block);
 
-			increase_indentation_level(default_data);
+			default_data.increase_indentation_level();
 
 			code += "\tdefault: {\n";
 			code += default_data;
 			code += "\t}\n";
-
-			_blocks.erase(default_block);
 		}
 
 		code += "\t}\n";
-
-		// Remove consumed blocks to save memory
-		_blocks.erase(selector_block);
-		for (const id case_block : case_blocks)
-			_blocks.erase(case_block);
 	}
 
 	id   create_block() override
 	{
 		const id res = make_id();
 
-		std::string &block = _blocks.emplace(res, std::string()).first->second;
-		// Reserve a decently big enough memory block to avoid frequent reallocations
-		block.reserve(4096);
+		_blocks.try_emplace(res);
 
 		return res;
 	}
@@ -1811,7 +1832,7 @@ private:
 		if (!is_in_block())
 			return 0;
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += "\tdiscard;\n";
 
@@ -1835,7 +1856,7 @@ private:
 		if (!_functions.back()->return_type.is_void() && value == 0)
 			return set_block(0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += "\treturn";
 
@@ -1858,7 +1879,7 @@ private:
 		if (!is_in_block())
 			return _last_block;
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		switch (loop_flow)
 		{
@@ -1866,7 +1887,8 @@ private:
 			code += "\tbreak;\n";
 			break;
 		case 2: // Keep track of continue target block, so we can insert its code here later
-			code += "__CONTINUE__" + std::to_string(target) + "\tcontinue;\n";
+			code.append_continue(_blocks.at(target), target);
+			code += "\tcontinue;\n";
 			break;
 		}
 
@@ -1883,7 +1905,14 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		text_block &code = _blocks.at(0);
+
+		// Function body is only referenced here and not copied
+		code += "{\n";
+		code += _blocks.at(_last_block);
+		code += "}\n";
+
+		_entry_point_guards.end(code, _functions.back()->definition);
 	}
 };
 
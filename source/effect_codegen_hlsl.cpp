@@ -5,6 +5,7 @@
 
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
+#include "effect_codegen_text.hpp"
 #include <cmath> // signbit, isinf, isnan
 #include <cstdio> // snprintf
 #include <cassert>
@@ -19,9 +20,8 @@ public:
 	codegen_hlsl(unsigned int shader_model, bool debug_info, bool uniforms_to_spec_constants)
 		: _shader_model(shader_model), _debug_info(debug_info), _uniforms_to_spec_constants(uniforms_to_spec_constants)
 	{
-		// Create default block and reserve a memory block to avoid frequent reallocations
-		std::string &block = _blocks.emplace(0, std::string()).first->second;
-		block.reserve(8192);
+		// Create default block
+		_blocks.try_emplace(0);
 	}
 
 private:
@@ -35,10 +35,11 @@ private:
 		expression,
 	};
 
-	std::string _cbuffer_block;
+	std::pmr::string _cbuffer_block { &_arena };
 	std::string _current_location;
 	std::unordered_map<id, std::string> _names;
-	std::unordered_map<id, std::string> _blocks;
+	std::pmr::unordered_map<id, text_block> _blocks { &_arena };
+	entry_point_guards _entry_point_guards;
 	bool _debug_info = false;
 	bool _uniforms_to_spec_constants = false;
 	unsigned int _shader_model = 0;
@@ -101,11 +102,13 @@ private:
 			module.total_uniform_size *= 4;
 		}
 
-		module.hlsl += _blocks.at(0);
+		_entry_point_guards.write_conditions(module.entry_points.size());
+
+		_blocks.at(0).write(module.hlsl);
 	}
 
-	template <bool is_param = false, bool is_decl = true>
-	void write_type(std::string &s, const type &type) const
+	template <bool is_param = false, bool is_decl = true, typename string_type>
+	void write_type(string_type &s, const type &type) const
 	{
 		if constexpr (is_decl)
 		{
@@ -183,7 +186,8 @@ private:
 		if (type.cols > 1)
 			s += 'x' + std::to_string(type.cols);
 	}
-	void write_constant(std::string &s, const type &type, const constant &data) const
+	template <typename string_type>
+	void write_constant(string_type &s, const type &type, const constant &data) const
 	{
 		if (type.is_array())
 		{
@@ -259,24 +263,24 @@ private:
 		if (!type.is_scalar())
 			s += ')';
 	}
-	template <bool force_source = false>
-	void write_location(std::string &s, const location &loc)
+	template <bool force_source = false, typename string_type>
+	void write_location(string_type &s, const location &loc)
 	{
 		if (loc.source.empty() || !_debug_info)
 			return;
 
-		s += "#line " + std::to_string(loc.line);
+		std::string line = "#line " + std::to_string(loc.line);
 
-		size_t offset = s.size();
+		size_t offset = line.size();
 
 		// Avoid writing the file name every time to reduce output text size
 		if constexpr (force_source)
 		{
-			s += " \"" + loc.source + '\"';
+			line += " \"" + loc.source + '\"';
 		}
 		else if (loc.source != _current_location)
 		{
-			s += " \"" + loc.source + '\"';
+			line += " \"" + loc.source + '\"';
 
 			_current_location = loc.source;
 		}
@@ -284,11 +288,13 @@ private:
 		// Need to escape string for new DirectX Shader Compiler (dxc)
 		if (_shader_model >= 60)
 		{
-			for (; (offset = s.find('\\', offset)) != std::string::npos; offset += 2)
-				s.insert(offset, "\\", 1);
+			for (; (offset = line.find('\\', offset)) != std::string::npos; offset += 2)
+				line.insert(offset, "\\", 1);
 		}
 
-		s += '\n';
+		line += '\n';
+
+		s += line;
 	}
 
 	std::string id_to_name(id id) const
@@ -362,10 +368,19 @@ private:
 		if (block.empty())
 			return;
 
-		for (size_t pos = 0; (pos = block.find("\n\t", pos)) != std::string::npos; pos += 3)
-			block.replace(pos, 2, "\n\t\t");
+		std::string result;
+		result.reserve(block.size() + std::count(block.begin(), block.end(), '\n') + 1);
+		result += '\t';
+
+		for (size_t i = 0; i < block.size(); ++i)
+		{
+			result += block[i];
+
+			if (block[i] == '\n' && i + 1 < block.size() && block[i + 1] == '\t')
+				result += '\t';
+		}
 
-		block.insert(block.begin(), '\t');
+		block = std::move(result);
 	}
 
 	id   define_struct(const location &loc, struct_info &info) override
@@ -375,7 +390,7 @@ private:
 
 		_structs.push_back(info);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -409,7 +424,7 @@ private:
 			info.binding = _module.num_texture_bindings;
 			_module.num_texture_bindings += 2;
 
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			write_location(code, loc);
 
@@ -431,7 +446,7 @@ private:
 			[&info](const auto &it) { return it.unique_name == info.texture_name; });
 		assert(texture != _module.textures.end());
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		if (_shader_model >= 40)
 		{
@@ -453,15 +468,21 @@ private:
 			assert(info.srgb == 0 || info.srgb == 1);
 			info.texture_binding = texture->binding + info.srgb; // Offset binding by one to choose the SRGB variant
 
+			_entry_point_guards.begin(code, info.id);
+
 			write_location(code, loc);
 
 			code += "static const __sampler2D " + id_to_name(info.id) + " = { " + (info.srgb ? "__srgb" : "__") + info.texture_name + ", __s" + std::to_string(info.binding) + " };\n";
+
+			_entry_point_guards.end(code, info.id);
 		}
 		else
 		{
 			info.binding = _module.num_sampler_bindings++;
 			info.texture_binding = ~0u; // Unset texture binding
 
+			_entry_point_guards.begin(code, info.id);
+
 			code += "sampler2D __" + info.unique_name + "_s : register(s" + std::to_string(info.binding) + ");\n";
 
 			write_location(code, loc);
@@ -474,6 +495,8 @@ private:
 				code += texture->semantic + "_PIXEL_SIZE"; // Expect application to set inverse texture size via a define if it is not known here
 
 			code += ") }; \n";
+
+			_entry_point_guards.end(code, info.id);
 		}
 
 		_module.samplers.push_back(info);
@@ -491,11 +514,15 @@ private:
 		{
 			info.binding = _module.num_storage_bindings++;
 
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
+
+			_entry_point_guards.begin(code, info.id);
 
 			write_location(code, loc);
 
 			code += "RWTexture2D<float4> " + info.unique_name + " : register(u" + std::to_string(info.binding) + ");\n";
+
+			_entry_point_guards.end(code, info.id);
 		}
 
 		_module.storages.push_back(info);
@@ -514,7 +541,7 @@ private:
 			if (info.type.is_array())
 				info.size *= info.type.array_length;
 
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			write_location(code, loc);
 
@@ -591,7 +618,7 @@ private:
 		if (!name.empty())
 			define_name<naming::general>(res, name);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -612,12 +639,21 @@ private:
 		return res;
 	}
 	id   define_function(const location &loc, function_info &info) override
+	{
+		return define_function(loc, info, false);
+	}
+
+	id   define_function(const location &loc, function_info &info, bool is_entry_point)
 	{
 		info.definition = make_id();
 
 		define_name<naming::unique>(info.definition, info.unique_name);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
+
+		// Entry point functions are already guarded as a whole
+		if (!is_entry_point)
+			_entry_point_guards.begin(code, info.definition);
 
 		write_location(code, loc);
 
@@ -676,6 +712,8 @@ private:
 
 		_module.entry_points.push_back({ func.unique_name, stype });
 
+		_entry_point_guards.add_entry_point(func.unique_name, func);
+
 		// Only have to rewrite the entry point function signature in shader model 3 and for compute (to write "numthreads" attribute)
 		if (_shader_model >= 40 && stype != shader_type::cs)
 			return;
@@ -736,16 +774,18 @@ private:
 			}
 		}
 
+		_blocks.at(0) += "#ifdef ENTRY_POINT_" + func.unique_name + '\n';
+
 		if (stype == shader_type::cs)
 			_blocks.at(_current_block) += "[numthreads(" +
 				std::to_string(num_threads[0]) + ", " +
 				std::to_string(num_threads[1]) + ", " +
 				std::to_string(num_threads[2]) + ")]\n";
 
-		define_function({}, entry_point);
+		define_function({}, entry_point, true);
 		enter_block(create_block());
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		// Clear all color output parameters so no component is left uninitialized
 		for (struct_member_info &param : entry_point.parameter_list)
@@ -801,6 +841,8 @@ private:
 
 		leave_block_and_return(func.return_type.is_void() ? 0 : ret);
 		leave_function();
+
+		_blocks.at(0) += "#endif\n";
 	}
 
 	id   emit_load(const expression &exp, bool force_new_id) override
@@ -859,7 +901,7 @@ private:
 		if (force_new_id)
 		{
 			// Need to store value in a new variable to comply with request for a new ID
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			code += '\t';
 			write_type(code, exp.type);
@@ -875,7 +917,7 @@ private:
 	}
 	void emit_store(const expression &exp, id value) override
 	{
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, exp.location);
 
@@ -922,7 +964,7 @@ private:
 
 		if (type.is_array())
 		{
-			std::string &code = _blocks.at(_current_block);
+			text_block &code = _blocks.at(_current_block);
 
 			// Array constants need to be stored in a constant variable as they cannot be used in-place
 			code += "\tconst ";
@@ -946,7 +988,7 @@ private:
 	{
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -967,7 +1009,7 @@ private:
 	{
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1079,7 +1121,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1103,7 +1145,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1143,7 +1185,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1193,7 +1235,7 @@ private:
 
 		const id res = make_id();
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		write_location(code, loc);
 
@@ -1233,13 +1275,13 @@ private:
 	{
 		assert(condition_value != 0 && condition_block != 0 && true_statement_block != 0 && false_statement_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
-		std::string &true_statement_data = _blocks.at(true_statement_block);
-		std::string &false_statement_data = _blocks.at(false_statement_block);
+		text_block &true_statement_data = _blocks.at(true_statement_block);
+		text_block &false_statement_data = _blocks.at(false_statement_block);
 
-		increase_indentation_level(true_statement_data);
-		increase_indentation_level(false_statement_data);
+		true_statement_data.increase_indentation_level();
+		false_statement_data.increase_indentation_level();
 
 		code += _blocks.at(condition_block);
 
@@ -1260,23 +1302,37 @@ private:
 			code += false_statement_data;
 			code += "\t}\n";
 		}
+	}
+	void emit_block(const location &loc, id prev_block, id statement_block) override
+	{
+		assert(prev_block != 0 && statement_block != 0);
+
+		text_block &code = _blocks.at(_current_block);
+
+		text_block &statement_data = _blocks.at(statement_block);
+
+		statement_data.increase_indentation_level();
+
+		code += _blocks.at(prev_block);
+
+		write_location(code, loc);
 
-		// Remove consumed blocks to save memory
-		_blocks.erase(condition_block);
-		_blocks.erase(true_statement_block);
-		_blocks.erase(false_statement_block);
+		// Keep the braces, so that variables declared in the statements stay in their own scope
+		code += "\t{\n";
+		code += statement_data;
+		code += "\t}\n";
 	}
 	id   emit_phi(const location &loc, id condition_value, id condition_block, id true_value, id true_statement_block, id false_value, id false_statement_block, const type &type) override
 	{
 		assert(condition_value != 0 && condition_block != 0 && true_value != 0 && true_statement_block != 0 && false_value != 0 && false_statement_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
-		std::string &true_statement_data = _blocks.at(true_statement_block);
-		std::string &false_statement_data = _blocks.at(false_statement_block);
+		text_block &true_statement_data = _blocks.at(true_statement_block);
+		text_block &false_statement_data = _blocks.at(false_statement_block);
 
-		increase_indentation_level(true_statement_data);
-		increase_indentation_level(false_statement_data);
+		true_statement_data.increase_indentation_level();
+		false_statement_data.increase_indentation_level();
 
 		const id res = make_id();
 
@@ -1289,32 +1345,32 @@ private:
 		write_location(code, loc);
 
 		code += "\tif (" + id_to_name(condition_value) + ")\n\t{\n";
-		code += (true_statement_block != condition_block ? true_statement_data : std::string());
+		if (true_statement_block != condition_block)
+			code += true_statement_data;
 		code += "\t\t" + id_to_name(res) + " = " + id_to_name(true_value) + ";\n";
 		code += "\t}\n\telse\n\t{\n";
-		code += (false_statement_block != condition_block ? false_statement_data : std::string());
+		if (false_statement_block != condition_block)
+			code += false_statement_data;
 		code += "\t\t" + id_to_name(res) + " = " + id_to_name(false_value) + ";\n";
 		code += "\t}\n";
 
-		// Remove consumed blocks to save memory
-		_blocks.erase(condition_block);
-		_blocks.erase(true_statement_block);
-		_blocks.erase(false_statement_block);
-
 		return res;
 	}
 	void emit_loop(const location &loc, id condition_value, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int flags) override
 	{
 		assert(prev_block != 0 && header_block != 0 && loop_block != 0 && continue_block != 0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
+
+		text_block &loop_data = _blocks.at(loop_block);
+		text_block &continue_block_data = _blocks.at(continue_block);
 
-		std::string &loop_data = _blocks.at(loop_block);
-		std::string &continue_data = _blocks.at(continue_block);
+		loop_data.increase_indentation_level();
+		loop_data.increase_indentation_level();
+		continue_block_data.increase_indentation_level();
 
-		increase_indentation_level(loop_data);
-		increase_indentation_level(loop_data);
-		increase_indentation_level(continue_data);
+		// The continue block is modified below, so need a copy of its code
+		std::string continue_data = continue_block_data.str();
 
 		code += _blocks.at(prev_block);
 
@@ -1335,9 +1391,7 @@ private:
 			continue_data.erase(pos_prev_assign + 1, pos_assign - pos_prev_assign - 1);
 
 			// We need to add the continue block to all "continue" statements as well
-			const std::string continue_id = "__CONTINUE__" + std::to_string(continue_block);
-			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
-				loop_data.replace(offset, continue_id.size(), continue_data);
+			continue_block_data.set_continue_substitution(continue_data, code);
 
 			code += "\tbool " + condition_name + ";\n";
 
@@ -1352,7 +1406,7 @@ private:
 		}
 		else
 		{
-			std::string &condition_data = _blocks.at(condition_block);
+			std::string condition_data = _blocks.at(condition_block).str();
 
 			// Work around D3DCompiler putting uniform variables that are used as the loop count register into integer registers (only in SM3)
 			// Only applies to dynamic loops with uniform variables in the condition, where it generates a loop instruction like "rep i0", but then expects the "i0" register to be set externally
@@ -1386,9 +1440,7 @@ private:
 				condition_data.erase(pos_prev_assign + 1, pos_assign - pos_prev_assign - 1);
 			}
 
-			const std::string continue_id = "__CONTINUE__" + std::to_string(continue_block);
-			for (size_t offset = 0; (offset = loop_data.find(continue_id, offset)) != std::string::npos; offset += continue_data.size())
-				loop_data.replace(offset, continue_id.size(), continue_data + condition_data);
+			continue_block_data.set_continue_substitution(continue_data + condition_data, code);
 
 			write_location(code, loc);
 
@@ -1404,22 +1456,14 @@ private:
 			code += continue_data;
 			code += condition_data;
 			code += "\t}\n";
-
-			_blocks.erase(condition_block);
 		}
-
-		// Remove consumed blocks to save memory
-		_blocks.erase(prev_block);
-		_blocks.erase(header_block);
-		_blocks.erase(loop_block);
-		_blocks.erase(continue_block);
 	}
 	void emit_switch(const location &loc, id selector_value, id selector_block, id default_label, id default_block, const std::vector<id> &case_literal_and_labels, const std::vector<id> &case_blocks, unsigned int flags) override
 	{
 		assert(selector_value != 0 && selector_block != 0 && default_label != 0 && default_block != 0);
 		assert(case_blocks.size() == case_literal_and_labels.size() / 2);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += _blocks.at(selector_block);
 
@@ -1462,9 +1506,9 @@ private:
 				}
 
 				assert(case_blocks[i / 2] != 0);
-				std::string &case_data = _blocks.at(case_blocks[i / 2]);
+				text_block &case_data = _blocks.at(case_blocks[i / 2]);
 
-				increase_indentation_level(case_data);
+				case_data.increase_indentation_level();
 
 				code += "{\n";
 				code += case_data;
@@ -1473,15 +1517,13 @@ private:
 
 			if (default_label != 0 && default_block != _current_block)
 			{
-				std::string &default_data = _blocks.at(default_block);
+				text_block &default_data = _blocks.at(default_block);
 
-				increase_indentation_level(default_data);
+				default_data.increase_indentation_level();
 
 				code += "\tdefault: {\n";
 				code += default_data;
 				code += "\t}\n";
-
-				_blocks.erase(default_block);
 			}
 
 			code += "\t}\n";
@@ -1513,9 +1555,9 @@ private:
 				}
 
 				assert(case_blocks[i / 2] != 0);
-				std::string &case_data = _blocks.at(case_blocks[i / 2]);
+				text_block &case_data = _blocks.at(case_blocks[i / 2]);
 
-				increase_indentation_level(case_data);
+				case_data.increase_indentation_level();
 
 				code += ")\n\t{\n";
 				code += case_data;
@@ -1526,31 +1568,22 @@ private:
 
 			if (default_block != _current_block)
 			{
-				std::string &default_data = _blocks.at(default_block);
+				text_block &default_data = _blocks.at(default_block);
 
-				increase_indentation_level(default_data);
+				default_data.increase_indentation_level();
 
 				code += default_data;
-
-				_blocks.erase(default_block);
 			}
 
 			code += "\t} } while (false);\n";
 		}
-
-		// Remove consumed blocks to save memory
-		_blocks.erase(selector_block);
-		for (const id case_block : case_blocks)
-			_blocks.erase(case_block);
 	}
 
 	id   create_block() override
 	{
 		const id res = make_id();
 
-		std::string &block = _blocks.emplace(res, std::string()).first->second;
-		// Reserve a decently big enough memory block to avoid frequent reallocations
-		block.reserve(4096);
+		_blocks.try_emplace(res);
 
 		return res;
 	}
@@ -1570,7 +1603,7 @@ private:
 		if (!is_in_block())
 			return 0;
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += "\tdiscard;\n";
 
@@ -1596,7 +1629,7 @@ private:
 		if (!_functions.back()->return_type.is_void() && value == 0)
 			return set_block(0);
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		code += "\treturn";
 
@@ -1619,7 +1652,7 @@ private:
 		if (!is_in_block())
 			return _last_block;
 
-		std::string &code = _blocks.at(_current_block);
+		text_block &code = _blocks.at(_current_block);
 
 		switch (loop_flow)
 		{
@@ -1627,7 +1660,8 @@ private:
 			code += "\tbreak;\n";
 			break;
 		case 2: // Keep track of continue target block, so we can insert its code here later
-			code += "__CONTINUE__" + std::to_string(target) + "\tcontinue;\n";
+			code.append_continue(_blocks.at(target), target);
+			code += "\tcontinue;\n";
 			break;
 		}
 
@@ -1644,7 +1678,14 @@ private:
 	{
 		assert(_last_block != 0);
 
-		_blocks.at(0) += "{\n" + _blocks.at(_last_block) + "}\n";
+		text_block &code = _blocks.at(0);
+
+		// Function body is only referenced here and not copied
+		code += "{\n";
+		code += _blocks.at(_last_block);
+		code += "}\n";
+
+		_entry_point_guards.end(code, _functions.back()->definition);
 	}
 };
 
@@ -7,6 +7,8 @@
 #include "effect_codegen.hpp"
 #include <cassert>
 #include <cstring> // memcmp
+#include <limits>
+#include <optional>
 #include <algorithm> // std::find_if, std::max
 #include <unordered_set>
 
@@ -18,28 +20,41 @@ namespace spv {
 
 using namespace reshadefx;
 
+struct spirv_basic_block;
+
 /// <summary>
-/// A single instruction in a SPIR-V module
+/// A single instruction in the word stream of a SPIR-V basic block
 /// </summary>
 struct spirv_instruction
 {
 	spv::Op op;
 	spv::Id type;
 	spv::Id result;
-	std::vector<spv::Id> operands;
 
-	explicit spirv_instruction(spv::Op op = spv::OpNop) : op(op), type(0), result(0) {}
-	spirv_instruction(spv::Op op, spv::Id result) : op(op), type(result), result(0) {}
-	spirv_instruction(spv::Op op, spv::Id type, spv::Id result) : op(op), type(type), result(result) {}
+	spirv_instruction(spirv_basic_block &block, size_t index);
+
+	/// <summary>
+	/// Get the number of operands of the instruction.
+	/// </summary>
+	size_t num_operands() const;
+	/// <summary>
+	/// Get the operand at the specified <paramref name="index"/>.
+	/// </summary>
+	spv::Id operand(size_t index) const;
+	/// <summary>
+	/// Overwrite the operand at the specified <paramref name="index"/> in place.
+	/// </summary>
+	void set_operand(size_t index, spv::Id operand);
+
+	/// <summary>
+	/// Set the result type of the instruction, inserting it into the word stream if it did not have one yet.
+	/// </summary>
+	void set_type(spv::Id type);
 
 	/// <summary>
 	/// Add a single operand to the instruction.
 	/// </summary>
-	spirv_instruction &add(spv::Id operand)
-	{
-		operands.push_back(operand);
-		return *this;
-	}
+	spirv_instruction &add(spv::Id operand);
 
 	/// <summary>
 	/// Add a range of operands to the instruction.
@@ -47,7 +62,8 @@ struct spirv_instruction
 	template <typename It>
 	spirv_instruction &add(It begin, It end)
 	{
-		operands.insert(operands.end(), begin, end);
+		for (; begin != end; ++begin)
+			add(*begin);
 		return *this;
 	}
 
@@ -66,11 +82,65 @@ struct spirv_instruction
 		return *this;
 	}
 
+private:
+	uint32_t *words() const;
+
+	spirv_basic_block *_block;
+	size_t _index;
+};
+
+/// <summary>
+/// A list of instructions forming a basic block in the SPIR-V module
+/// Instructions are stored already encoded in a single flat stream of words, so that the block can be written to the module as-is.
+/// </summary>
+struct spirv_basic_block
+{
+	using allocator_type = std::pmr::polymorphic_allocator<uint32_t>;
+
+	struct instruction_info
+	{
+		uint32_t offset : 30;
+		uint32_t has_type : 1;
+		uint32_t has_result : 1;
+	};
+
+	std::pmr::vector<uint32_t> words;
+	std::pmr::vector<instruction_info> instructions;
+
+	explicit spirv_basic_block(const allocator_type &alloc = {}) : words(alloc), instructions(alloc) {}
+
+	spirv_basic_block(const spirv_basic_block &other) = default;
+	spirv_basic_block(const spirv_basic_block &other, const allocator_type &alloc) : words(other.words, alloc), instructions(other.instructions, alloc) {}
+	spirv_basic_block(spirv_basic_block &&other) = default;
+	spirv_basic_block(spirv_basic_block &&other, const allocator_type &alloc) : words(std::move(other.words), alloc), instructions(std::move(other.instructions), alloc) {}
+
+	spirv_basic_block &operator=(const spirv_basic_block &other) = default;
+	spirv_basic_block &operator=(spirv_basic_block &&other) = default;
+
+	bool empty() const { return instructions.empty(); }
+	size_t size() const { return instructions.size(); }
+
+	spirv_instruction operator[](size_t index) { return spirv_instruction(*this, index); }
+	spirv_instruction front() { return spirv_instruction(*this, 0); }
+	spirv_instruction back() { return spirv_instruction(*this, instructions.size() - 1); }
+
+	/// <summary>
+	/// Find the last instruction in this block that defines the specified <paramref name="result"/> ID.
+	/// </summary>
+	spirv_instruction find_result(spv::Id result)
+	{
+		for (size_t index = instructions.size(); index-- > 0;)
+			if (const instruction_info info = instructions[index]; info.has_result && words[info.offset + 1 + info.has_type] == result)
+				return spirv_instruction(*this, index);
+
+		assert(false);
+		return back();
+	}
+
 	/// <summary>
-	/// Write this instruction to a SPIR-V module.
+	/// Encode a new instruction at the end of this block. A <paramref name="type"/> or <paramref name="result"/> of zero is omitted from the encoding.
 	/// </summary>
-	/// <param name="output">The output stream to append this instruction to.</param>
-	void write(std::vector<uint32_t> &output) const
+	spirv_instruction add(spv::Op op, spv::Id type = 0, spv::Id result = 0)
 	{
 		// See https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html
 		// 0             | Opcode: The 16 high-order bits are the WordCount of the instruction. The 16 low-order bits are the opcode enumerant.
@@ -81,38 +151,162 @@ struct spirv_instruction
 		// ...           | ...
 		// WordCount - 1 | Operand N (N is determined by WordCount minus the 1 to 3 words used for the opcode, instruction type <id>, and instruction Result <id>).
 
-		const uint32_t num_words = 1 + (type != 0) + (result != 0) + static_cast<uint32_t>(operands.size());
-		output.push_back((num_words << spv::WordCountShift) | op);
+		instruction_info &info = instructions.emplace_back();
+		info.offset = static_cast<uint32_t>(words.size());
+		info.has_type = type != 0;
+		info.has_result = result != 0;
+
+		const uint32_t num_words = 1 + info.has_type + info.has_result;
+		words.push_back((num_words << spv::WordCountShift) | op);
 
 		// Optional instruction type ID
 		if (type != 0)
-			output.push_back(type);
+			words.push_back(type);
 
 		// Optional instruction result ID
 		if (result != 0)
-			output.push_back(result);
+			words.push_back(result);
 
-		// Write out the operands
-		output.insert(output.end(), operands.begin(), operands.end());
+		return spirv_instruction(*this, instructions.size() - 1);
 	}
-};
 
-/// <summary>
-/// A list of instructions forming a basic block in the SPIR-V module
-/// </summary>
-struct spirv_basic_block
-{
-	std::vector<spirv_instruction> instructions;
+	/// <summary>
+	/// Remove the last instruction from this block.
+	/// </summary>
+	void pop_back()
+	{
+		words.resize(instructions.back().offset);
+		instructions.pop_back();
+	}
+
+	/// <summary>
+	/// Remove the last instruction from this block and return it as a block of its own, so that it can be appended again elsewhere.
+	/// </summary>
+	spirv_basic_block split_back()
+	{
+		spirv_basic_block block(words.get_allocator());
+		block.append_instruction(*this, instructions.size() - 1);
+		pop_back();
+		return block;
+	}
+
+	/// <summary>
+	/// Append another basic block the end of this one. The other block is left empty afterwards.
+	/// </summary>
+	void append(spirv_basic_block &&block)
+	{
+		if (instructions.empty())
+		{
+			// Take over the word stream of the other block when this one is empty (which is the case for the merge block of most control flow constructs, so that their body is not copied again)
+			words = std::move(block.words);
+			instructions = std::move(block.instructions);
+		}
+		else
+		{
+			const uint32_t base_offset = static_cast<uint32_t>(words.size());
+			words.insert(words.end(), block.words.begin(), block.words.end());
+			instructions.reserve(instructions.size() + block.instructions.size());
+			for (instruction_info info : block.instructions)
+				info.offset += base_offset,
+				instructions.push_back(info);
+		}
+
+		block.words.clear();
+		block.instructions.clear();
+	}
+	/// <summary>
+	/// Append a copy of a single instruction from another basic block to the end of this one.
+	/// </summary>
+	void append_instruction(const spirv_basic_block &block, size_t index)
+	{
+		instruction_info info = block.instructions[index];
+		const uint32_t begin = info.offset;
+		const uint32_t end = index + 1 < block.instructions.size() ? block.instructions[index + 1].offset : static_cast<uint32_t>(block.words.size());
+
+		info.offset = static_cast<uint32_t>(words.size());
+		instructions.push_back(info);
+		words.insert(words.end(), block.words.begin() + begin, block.words.begin() + end);
+	}
 
 	/// <summary>
-	/// Append another basic block the end of this one.
+	/// Write the instructions in the range [<paramref name="first"/>, <paramref name="last"/>) of this block to a SPIR-V module.
 	/// </summary>
-	void append(const spirv_basic_block &block)
+	/// <param name="output">The output stream to append the instructions to.</param>
+	void write(std::vector<uint32_t> &output, size_t first = 0, size_t last = std::numeric_limits<size_t>::max()) const
 	{
-		instructions.insert(instructions.end(), block.instructions.begin(), block.instructions.end());
+		const uint32_t begin = first < instructions.size() ? instructions[first].offset : static_cast<uint32_t>(words.size());
+		const uint32_t end = last < instructions.size() ? instructions[last].offset : static_cast<uint32_t>(words.size());
+
+		output.insert(output.end(), words.begin() + begin, words.begin() + end);
 	}
 };
 
+inline spirv_instruction::spirv_instruction(spirv_basic_block &block, size_t index) :
+	_block(&block), _index(index)
+{
+	const spirv_basic_block::instruction_info info = block.instructions[index];
+	const uint32_t *const word = block.words.data() + info.offset;
+
+	op = static_cast<spv::Op>(word[0] & spv::OpCodeMask);
+	type = info.has_type ? word[1] : 0;
+	result = info.has_result ? word[1 + info.has_type] : 0;
+}
+
+inline uint32_t *spirv_instruction::words() const
+{
+	return _block->words.data() + _block->instructions[_index].offset;
+}
+
+inline size_t spirv_instruction::num_operands() const
+{
+	const spirv_basic_block::instruction_info info = _block->instructions[_index];
+	return (words()[0] >> spv::WordCountShift) - 1 - info.has_type - info.has_result;
+}
+inline spv::Id spirv_instruction::operand(size_t index) const
+{
+	assert(index < num_operands());
+	const spirv_basic_block::instruction_info info = _block->instructions[_index];
+	return words()[1 + info.has_type + info.has_result + index];
+}
+inline void spirv_instruction::set_operand(size_t index, spv::Id operand)
+{
+	assert(index < num_operands());
+	const spirv_basic_block::instruction_info info = _block->instructions[_index];
+	words()[1 + info.has_type + info.has_result + index] = operand;
+}
+
+inline void spirv_instruction::set_type(spv::Id new_type)
+{
+	assert(new_type != 0);
+	spirv_basic_block::instruction_info &info = _block->instructions[_index];
+
+	if (!info.has_type)
+	{
+		// Can only grow the last instruction in a block, since it would overlap the following instruction otherwise
+		assert(_index == _block->instructions.size() - 1);
+
+		_block->words.insert(_block->words.begin() + info.offset + 1, new_type);
+		_block->words[info.offset] += 1 << spv::WordCountShift;
+		info.has_type = true;
+	}
+	else
+	{
+		words()[1] = new_type;
+	}
+
+	type = new_type;
+}
+
+inline spirv_instruction &spirv_instruction::add(spv::Id operand)
+{
+	// Operands can only be added to the last instruction in a block, since they are appended to the end of the word stream
+	assert(_index == _block->instructions.size() - 1);
+
+	_block->words.push_back(operand);
+	_block->words[_block->instructions[_index].offset] += 1 << spv::WordCountShift;
+	return *this;
+}
+
 class codegen_spirv final : public codegen
 {
 public:
@@ -137,13 +331,33 @@ private:
 	};
 	struct function_blocks
 	{
+		using allocator_type = spirv_basic_block::allocator_type;
+
 		spirv_basic_block declaration;
 		spirv_basic_block variables;
 		spirv_basic_block definition;
 		type return_type;
 		std::vector<type> param_types;
 
-		friend bool operator==(const function_blocks &lhs, const function_blocks &rhs)
+		explicit function_blocks(const allocator_type &alloc = {}) : declaration(alloc), variables(alloc), definition(alloc) {}
+
+		function_blocks(const function_blocks &other) = default;
+		function_blocks(const function_blocks &other, const allocator_type &alloc) :
+			declaration(other.declaration, alloc), variables(other.variables, alloc), definition(other.definition, alloc), return_type(other.return_type), param_types(other.param_types) {}
+		function_blocks(function_blocks &&other) = default;
+		function_blocks(function_blocks &&other, const allocator_type &alloc) :
+			declaration(std::move(other.declaration), alloc), variables(std::move(other.variables), alloc), definition(std::move(other.definition), alloc), return_type(std::move(other.return_type)), param_types(std::move(other.param_types)) {}
+
+		function_blocks &operator=(const function_blocks &other) = default;
+		function_blocks &operator=(function_blocks &&other) = default;
+
+	};
+	struct function_type_lookup
+	{
+		type return_type;
+		std::vector<type> param_types;
+
+		friend bool operator==(const function_type_lookup &lhs, const function_type_lookup &rhs)
 		{
 			if (lhs.param_types.size() != rhs.param_types.size())
 				return false;
@@ -153,26 +367,80 @@ private:
 			return lhs.return_type == rhs.return_type;
 		}
 	};
+	struct constant_lookup
+	{
+		reshadefx::type type;
+		reshadefx::constant data;
+
+		friend bool operator==(const constant_lookup &lhs, const constant_lookup &rhs)
+		{
+			if (!(lhs.type == rhs.type && std::memcmp(&lhs.data.as_uint[0], &rhs.data.as_uint[0], sizeof(uint32_t) * 16) == 0 && lhs.data.array_data.size() == rhs.data.array_data.size()))
+				return false;
+			for (size_t i = 0; i < lhs.data.array_data.size(); ++i)
+				if (std::memcmp(&lhs.data.array_data[i].as_uint[0], &rhs.data.array_data[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
+					return false;
+			return true;
+		}
+	};
+
+	/// <summary>
+	/// Hashes the lookup keys above, covering exactly the fields their equality operators compare.
+	/// </summary>
+	struct lookup_hash
+	{
+		static uint64_t hash_words(const uint32_t *words, size_t count, uint64_t hash = 14695981039346656037ull)
+		{
+			// Based on the FNV-1a hash function, but mixing in whole words instead of bytes
+			for (size_t i = 0; i < count; ++i)
+				hash = (hash ^ words[i]) * 1099511628211ull;
+			return hash;
+		}
+		static uint64_t hash_type(const type &type, uint64_t hash = 14695981039346656037ull)
+		{
+			const uint32_t words[5] = { type.base, type.rows, type.cols, static_cast<uint32_t>(type.array_length), type.definition };
+			return hash_words(words, 5, hash);
+		}
+
+		size_t operator()(const type_lookup &lookup) const
+		{
+			const uint32_t words[3] = { lookup.is_ptr, lookup.array_stride, static_cast<uint32_t>(lookup.storage) };
+			return static_cast<size_t>(hash_words(words, 3, hash_type(lookup.type)));
+		}
+		size_t operator()(const function_type_lookup &lookup) const
+		{
+			uint64_t hash = hash_type(lookup.return_type);
+			for (const type &param_type : lookup.param_types)
+				hash = hash_type(param_type, hash);
+			return static_cast<size_t>(hash);
+		}
+		size_t operator()(const constant_lookup &lookup) const
+		{
+			uint64_t hash = hash_words(lookup.data.as_uint, 16, hash_type(lookup.type));
+			for (const constant &element : lookup.data.array_data)
+				hash = hash_words(element.as_uint, 16, hash);
+			return static_cast<size_t>(hash);
+		}
+	};
 
-	spirv_basic_block _entries;
-	spirv_basic_block _execution_modes;
-	spirv_basic_block _debug_a;
-	spirv_basic_block _debug_b;
-	spirv_basic_block _annotations;
-	spirv_basic_block _types_and_constants;
-	spirv_basic_block _variables;
+	spirv_basic_block _entries { &_arena };
+	spirv_basic_block _execution_modes { &_arena };
+	spirv_basic_block _debug_a { &_arena };
+	spirv_basic_block _debug_b { &_arena };
+	spirv_basic_block _annotations { &_arena };
+	spirv_basic_block _types_and_constants { &_arena };
+	spirv_basic_block _variables { &_arena };
 
 	std::unordered_set<spv::Id> _spec_constants;
 	std::unordered_set<spv::Capability> _capabilities;
-	std::vector<std::pair<type_lookup, spv::Id>> _type_lookup;
-	std::vector<std::tuple<type, constant, spv::Id>> _constant_lookup;
-	std::vector<std::pair<function_blocks, spv::Id>> _function_type_lookup;
+	std::pmr::unordered_map<type_lookup, spv::Id, lookup_hash> _type_lookup { &_arena };
+	std::pmr::unordered_map<constant_lookup, spv::Id, lookup_hash> _constant_lookup { &_arena };
+	std::pmr::unordered_map<function_type_lookup, spv::Id, lookup_hash> _function_type_lookup { &_arena };
 	std::unordered_map<std::string, spv::Id> _string_lookup;
 	std::unordered_map<spv::Id, spv::StorageClass> _storage_lookup;
 	std::unordered_map<std::string, uint32_t> _semantic_to_location;
 
-	std::vector<function_blocks> _functions_blocks;
-	std::unordered_map<id, spirv_basic_block> _block_data;
+	std::pmr::vector<function_blocks> _functions_blocks { &_arena };
+	std::pmr::unordered_map<id, spirv_basic_block> _block_data { &_arena };
 	spirv_basic_block *_current_block_data = nullptr;
 
 	bool _debug_info = false;
@@ -210,33 +478,27 @@ private:
 			.add(loc.line)
 			.add(loc.column);
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type = 0)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type = 0)
 	{
 		assert(is_in_function() && is_in_block());
 		return add_instruction(op, type, *_current_block_data);
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block)
 	{
-		spirv_instruction &instruction = add_instruction_without_result(op, block);
-		instruction.type = type;
-		instruction.result = make_id();
-		return instruction;
+		return block.add(op, type, make_id());
 	}
-	inline spirv_instruction &add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block, spv::Id &result)
+	inline spirv_instruction add_instruction(spv::Op op, spv::Id type, spirv_basic_block &block, spv::Id &result)
 	{
-		spirv_instruction &instruction = add_instruction_without_result(op, block);
-		instruction.type = type;
-		instruction.result = result = make_id();
-		return instruction;
+		return block.add(op, type, result = make_id());
 	}
-	inline spirv_instruction &add_instruction_without_result(spv::Op op)
+	inline spirv_instruction add_instruction_without_result(spv::Op op)
 	{
 		assert(is_in_function() && is_in_block());
 		return add_instruction_without_result(op, *_current_block_data);
 	}
-	inline spirv_instruction &add_instruction_without_result(spv::Op op, spirv_basic_block &block)
+	inline spirv_instruction add_instruction_without_result(spv::Op op, spirv_basic_block &block)
 	{
-		return block.instructions.emplace_back(op);
+		return block.add(op);
 	}
 
 	void write_result(module &module) override
@@ -244,98 +506,100 @@ private:
 		// First initialize the UBO type now that all member types are known
 		if (_global_ubo_type != 0)
 		{
-			spirv_instruction &type_inst = add_instruction_without_result(spv::OpTypeStruct, _types_and_constants);
-			type_inst.add(_global_ubo_types.begin(), _global_ubo_types.end());
-			type_inst.result = _global_ubo_type;
+			_types_and_constants.add(spv::OpTypeStruct, 0, _global_ubo_type)
+				.add(_global_ubo_types.begin(), _global_ubo_types.end());
 
-			spirv_instruction &variable_inst = add_instruction_without_result(spv::OpVariable, _variables);
-			variable_inst.add(spv::StorageClassUniform);
-			variable_inst.type = convert_type({ type::t_struct, 0, 0, type::q_uniform, 0, _global_ubo_type }, true, spv::StorageClassUniform);
-			variable_inst.result = _global_ubo_variable;
+			const spv::Id variable_type = convert_type({ type::t_struct, 0, 0, type::q_uniform, 0, _global_ubo_type }, true, spv::StorageClassUniform);
+			_variables.add(spv::OpVariable, variable_type, _global_ubo_variable)
+				.add(spv::StorageClassUniform);
 
-			add_name(variable_inst.result, "$Globals");
+			add_name(_global_ubo_variable, "$Globals");
 		}
 
 		module = std::move(_module);
 
-		// Write SPIRV header info
-		module.spirv.push_back(spv::MagicNumber);
-		module.spirv.push_back(0x10300); // Force SPIR-V 1.3
-		module.spirv.push_back(0u); // Generator magic number, see https://www.khronos.org/registry/spir-v/api/spir-v.xml
-		module.spirv.push_back(_next_id); // Maximum ID
-		module.spirv.push_back(0u); // Reserved for instruction schema
+		spirv_basic_block preamble(&_arena);
 
 		// All capabilities
-		spirv_instruction(spv::OpCapability)
-			.add(spv::CapabilityShader) // Implicitly declares the Matrix capability too
-			.write(module.spirv);
+		preamble.add(spv::OpCapability)
+			.add(spv::CapabilityShader); // Implicitly declares the Matrix capability too
 
 		for (spv::Capability capability : _capabilities)
-			spirv_instruction(spv::OpCapability)
-				.add(capability)
-				.write(module.spirv);
+			preamble.add(spv::OpCapability)
+				.add(capability);
 
 		// Optional extension instructions
-		spirv_instruction(spv::OpExtInstImport, _glsl_ext)
-			.add_string("GLSL.std.450") // Import GLSL extension
-			.write(module.spirv);
+		preamble.add(spv::OpExtInstImport, 0, _glsl_ext)
+			.add_string("GLSL.std.450"); // Import GLSL extension
 
 		// Single required memory model instruction
-		spirv_instruction(spv::OpMemoryModel)
+		preamble.add(spv::OpMemoryModel)
 			.add(spv::AddressingModelLogical)
-			.add(spv::MemoryModelGLSL450)
-			.write(module.spirv);
+			.add(spv::MemoryModelGLSL450);
+
+		spirv_basic_block source(&_arena);
+		source.add(spv::OpSource)
+			.add(spv::SourceLanguageUnknown) // ReShade FX is not a reserved token at the moment
+			.add(0); // Language version, TODO: Maybe fill in ReShade version here?
+
+		// Since all blocks are encoded already, the total size of the module is known up front
+		size_t num_words = 5 + preamble.words.size() + _entries.words.size() + _execution_modes.words.size() + source.words.size() + _annotations.words.size() + _types_and_constants.words.size() + _variables.words.size();
+		if (_debug_info)
+			num_words += _debug_a.words.size() + _debug_b.words.size();
+		for (const auto &function : _functions_blocks)
+			if (!function.definition.empty())
+				num_words += function.declaration.words.size() + function.variables.words.size() + function.definition.words.size();
+
+		module.spirv.reserve(num_words);
+
+		// Write SPIRV header info
+		module.spirv.push_back(spv::MagicNumber);
+		module.spirv.push_back(0x10300); // Force SPIR-V 1.3
+		module.spirv.push_back(0u); // Generator magic number, see https://www.khronos.org/registry/spir-v/api/spir-v.xml
+		module.spirv.push_back(_next_id); // Maximum ID
+		module.spirv.push_back(0u); // Reserved for instruction schema
+
+		preamble.write(module.spirv);
 
 		// All entry point declarations
-		for (const auto &node : _entries.instructions)
-			node.write(module.spirv);
+		_entries.write(module.spirv);
 
 		// All execution mode declarations
-		for (const auto &node : _execution_modes.instructions)
-			node.write(module.spirv);
+		_execution_modes.write(module.spirv);
 
-		spirv_instruction(spv::OpSource)
-			.add(spv::SourceLanguageUnknown) // ReShade FX is not a reserved token at the moment
-			.add(0) // Language version, TODO: Maybe fill in ReShade version here?
-			.write(module.spirv);
+		source.write(module.spirv);
 
 		if (_debug_info)
 		{
 			// All debug instructions
-			for (const auto &node : _debug_a.instructions)
-				node.write(module.spirv);
-			for (const auto &node : _debug_b.instructions)
-				node.write(module.spirv);
+			_debug_a.write(module.spirv);
+			_debug_b.write(module.spirv);
 		}
 
 		// All annotation instructions
-		for (const auto &node : _annotations.instructions)
-			node.write(module.spirv);
+		_annotations.write(module.spirv);
 
 		// All type declarations
-		for (const auto &node : _types_and_constants.instructions)
-			node.write(module.spirv);
-		for (const auto &node : _variables.instructions)
-			node.write(module.spirv);
+		_types_and_constants.write(module.spirv);
+		_variables.write(module.spirv);
 
 		// All function definitions
-		for (const auto &function : _functions_blocks)
+		for (auto &function : _functions_blocks)
 		{
-			if (function.definition.instructions.empty())
+			if (function.definition.empty())
 				continue;
 
-			for (const auto &node : function.declaration.instructions)
-				node.write(module.spirv);
+			function.declaration.write(module.spirv);
 
 			// Grab first label and move it in front of variable declarations
-			function.definition.instructions.front().write(module.spirv);
-			assert(function.definition.instructions.front().op == spv::OpLabel);
+			assert(function.definition.front().op == spv::OpLabel);
+			function.definition.write(module.spirv, 0, 1);
 
-			for (const auto &node : function.variables.instructions)
-				node.write(module.spirv);
-			for (auto it = function.definition.instructions.begin() + 1; it != function.definition.instructions.end(); ++it)
-				it->write(module.spirv);
+			function.variables.write(module.spirv);
+			function.definition.write(module.spirv, 1);
 		}
+
+		assert(module.spirv.size() == num_words);
 	}
 
 	spv::Id convert_type(type info, bool is_ptr = false, spv::StorageClass storage = spv::StorageClassFunction, uint32_t array_stride = 0)
@@ -354,8 +618,8 @@ private:
 			info.base = static_cast<type::datatype>(info.base + 1); // min16int -> int, min16uint -> uint, min16float -> float
 
 		const type_lookup lookup = { info, is_ptr, array_stride, storage };
-		if (const auto it = std::find_if(_type_lookup.begin(), _type_lookup.end(),
-			[&lookup](const auto &lookup_it) { return lookup_it.first == lookup; }); it != _type_lookup.end())
+		if (const auto it = _type_lookup.find(lookup);
+			it != _type_lookup.end())
 			return it->second;
 
 		spv::Id type, elem_type;
@@ -499,14 +763,15 @@ private:
 			}
 		}
 
-		_type_lookup.push_back({ lookup, type });
+		_type_lookup.emplace(lookup, type);
 
 		return type;
 	}
 	spv::Id convert_type(const function_blocks &info)
 	{
-		if (auto it = std::find_if(_function_type_lookup.begin(), _function_type_lookup.end(),
-			[&info](const auto &lookup) { return lookup.first == info; }); it != _function_type_lookup.end())
+		function_type_lookup lookup = { info.return_type, info.param_types };
+		if (const auto it = _function_type_lookup.find(lookup);
+			it != _function_type_lookup.end())
 			return it->second;
 
 		auto return_type = convert_type(info.return_type);
@@ -517,11 +782,11 @@ private:
 		for (const type &param_type : info.param_types)
 			param_type_ids.push_back(convert_type(param_type, true));
 
-		spirv_instruction &inst = add_instruction(spv::OpTypeFunction, 0, _types_and_constants);
+		spirv_instruction inst = add_instruction(spv::OpTypeFunction, 0, _types_and_constants);
 		inst.add(return_type);
 		inst.add(param_type_ids.begin(), param_type_ids.end());
 
-		_function_type_lookup.push_back({ info, inst.result });;
+		_function_type_lookup.emplace(std::move(lookup), inst.result);
 
 		return inst.result;
 	}
@@ -727,7 +992,7 @@ private:
 				_module.spec_constants.push_back(scalar_info);
 			};
 
-			const spirv_instruction &base_inst = _types_and_constants.instructions.back();
+			const spirv_instruction base_inst = _types_and_constants.back();
 			assert(base_inst.result == res);
 
 			// External specialization constants need to be scalars
@@ -740,24 +1005,22 @@ private:
 				assert(base_inst.op == spv::OpSpecConstantComposite);
 
 				// Add each individual scalar component of the constant as a separate external specialization constant
-				for (size_t i = 0; i < (info.type.is_array() ? base_inst.operands.size() : 1); ++i)
+				for (size_t i = 0; i < (info.type.is_array() ? base_inst.num_operands() : 1); ++i)
 				{
 					constant initializer_value = info.initializer_value;
 					spirv_instruction elem_inst = base_inst;
 
 					if (info.type.is_array())
 					{
-						elem_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[elem = base_inst.operands[i]](const auto &it) { return it.result == elem; });
+						elem_inst = _types_and_constants.find_result(base_inst.operand(i));
 
-						assert(initializer_value.array_data.size() == base_inst.operands.size());
+						assert(initializer_value.array_data.size() == base_inst.num_operands());
 						initializer_value = initializer_value.array_data[i];
 					}
 
-					for (size_t row = 0; row < elem_inst.operands.size(); ++row)
+					for (size_t row = 0; row < elem_inst.num_operands(); ++row)
 					{
-						const spirv_instruction &row_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-							[elem = elem_inst.operands[row]](const auto &it) { return it.result == elem; });
+						const spirv_instruction row_inst = _types_and_constants.find_result(elem_inst.operand(row));
 
 						if (row_inst.op != spv::OpSpecConstantComposite)
 						{
@@ -765,10 +1028,9 @@ private:
 							continue;
 						}
 
-						for (size_t col = 0; col < row_inst.operands.size(); ++col)
+						for (size_t col = 0; col < row_inst.num_operands(); ++col)
 						{
-							const spirv_instruction &col_inst = *std::find_if(_types_and_constants.instructions.rbegin(), _types_and_constants.instructions.rend(),
-								[elem = row_inst.operands[col]](const auto &it) { return it.result == elem; });
+							const spirv_instruction col_inst = _types_and_constants.find_result(row_inst.operand(col));
 
 							add_spec_constant(col_inst, info, initializer_value, row * info.type.cols + col);
 						}
@@ -867,7 +1129,7 @@ private:
 
 		spv::Id res;
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpVariable
-		spirv_instruction &inst = add_instruction(spv::OpVariable, convert_type(type, true, storage), block, res)
+		spirv_instruction inst = add_instruction(spv::OpVariable, convert_type(type, true, storage), block, res)
 			.add(storage);
 
 		if (initializer_value != 0)
@@ -1268,7 +1530,7 @@ private:
 				it != _storage_lookup.end())
 				storage = it->second;
 
-			spirv_instruction *access_chain = nullptr;
+			std::optional<spirv_instruction> access_chain;
 
 			// Check if this is a uniform variable (see 'define_uniform' function above) and dereference it
 			if (result & 0xF0000000)
@@ -1281,7 +1543,7 @@ private:
 				if (is_uniform_bool)
 					base_type.base = type::t_uint;
 
-				access_chain = &add_instruction(spv::OpAccessChain)
+				access_chain = add_instruction(spv::OpAccessChain)
 					.add(_global_ubo_variable)
 					.add(emit_constant(member_index));
 			}
@@ -1296,8 +1558,8 @@ private:
 				assert(_current_block_data != &_types_and_constants);
 
 				// Use access chain from uniform if possible, otherwise create new one
-				if (access_chain == nullptr) access_chain =
-					&add_instruction(spv::OpAccessChain).add(result); // Base
+				if (!access_chain.has_value()) access_chain =
+					add_instruction(spv::OpAccessChain).add(result); // Base
 
 				// Ignore first index into 1xN matrices, since they were translated to a vector type in SPIR-V
 				if (exp.chain[0].from.rows == 1 && exp.chain[0].from.cols > 1)
@@ -1312,12 +1574,12 @@ private:
 						emit_constant(exp.chain[i].index)); // Indexes
 
 				base_type = exp.chain[i - 1].to;
-				access_chain->type = convert_type(base_type, true, storage); // Last type is the result
+				access_chain->set_type(convert_type(base_type, true, storage)); // Last type is the result
 				result = access_chain->result;
 			}
-			else if (access_chain != nullptr)
+			else if (access_chain.has_value())
 			{
-				access_chain->type = convert_type(base_type, true, storage, base_type.is_array() ? 16u : 0u);
+				access_chain->set_type(convert_type(base_type, true, storage, base_type.is_array() ? 16u : 0u));
 				result = access_chain->result;
 			}
 
@@ -1445,7 +1707,7 @@ private:
 							scalar_type.rows = 1;
 							scalar_type.cols = 1;
 
-							spirv_instruction &node = add_instruction(spv::OpCompositeExtract, convert_type(scalar_type))
+							spirv_instruction node = add_instruction(spv::OpCompositeExtract, convert_type(scalar_type))
 								.add(result);
 
 							if (op.from.rows > 1) // Matrix types with a single row are actually vectors, so they don't need the extra index
@@ -1456,7 +1718,7 @@ private:
 							components[c] = node.result;
 						}
 
-						spirv_instruction &node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
+						spirv_instruction node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
 						for (unsigned int c = 0; c < 4 && op.swizzle[c] >= 0; ++c)
 							node.add(components[c]);
 						result = node.result;
@@ -1464,7 +1726,7 @@ private:
 					}
 					else if (op.from.is_vector())
 					{
-						spirv_instruction &node = add_instruction(spv::OpVectorShuffle, convert_type(op.to))
+						spirv_instruction node = add_instruction(spv::OpVectorShuffle, convert_type(op.to))
 							.add(result) // Vector 1
 							.add(result); // Vector 2
 						for (unsigned int c = 0; c < 4 && op.swizzle[c] >= 0; ++c)
@@ -1474,7 +1736,7 @@ private:
 					}
 					else
 					{
-						spirv_instruction &node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
+						spirv_instruction node = add_instruction(spv::OpCompositeConstruct, convert_type(op.to));
 						for (unsigned int c = 0; c < op.to.rows; ++c)
 							node.add(result);
 						result = node.result;
@@ -1485,7 +1747,7 @@ private:
 				{
 					assert(op.swizzle[1] < 0);
 
-					spirv_instruction &node = add_instruction(spv::OpCompositeExtract, convert_type(op.to))
+					spirv_instruction node = add_instruction(spv::OpCompositeExtract, convert_type(op.to))
 						.add(result); // Composite
 					if (op.from.rows > 1)
 					{
@@ -1542,7 +1804,7 @@ private:
 
 					if (base_type.is_vector())
 					{
-						spirv_instruction &node = add_instruction(spv::OpVectorShuffle, convert_type(base_type))
+						spirv_instruction node = add_instruction(spv::OpVectorShuffle, convert_type(base_type))
 							.add(result) // Vector 1
 							.add(value); // Vector 2
 
@@ -1559,7 +1821,7 @@ private:
 					{
 						assert(op.swizzle[1] < 0);
 
-						spirv_instruction &node = add_instruction(spv::OpCompositeInsert, convert_type(base_type))
+						spirv_instruction node = add_instruction(spv::OpCompositeInsert, convert_type(base_type))
 							.add(value) // Object
 							.add(result); // Composite
 
@@ -1611,8 +1873,8 @@ private:
 		// Ensure that 'access_chain' cannot get invalidated by calls to 'emit_constant' or 'convert_type'
 		assert(_current_block_data != &_types_and_constants);
 
-		spirv_instruction *access_chain =
-			&add_instruction(spv::OpAccessChain).add(exp.base); // Base
+		spirv_instruction access_chain =
+			add_instruction(spv::OpAccessChain).add(exp.base); // Base
 
 		// Ignore first index into 1xN matrices, since they were translated to a vector type in SPIR-V
 		if (exp.chain[0].from.rows == 1 && exp.chain[0].from.cols > 1)
@@ -1622,12 +1884,12 @@ private:
 			exp.chain[i].op == expression::operation::op_member ||
 			exp.chain[i].op == expression::operation::op_dynamic_index ||
 			exp.chain[i].op == expression::operation::op_constant_index); ++i)
-			access_chain->add(exp.chain[i].op == expression::operation::op_dynamic_index ?
+			access_chain.add(exp.chain[i].op == expression::operation::op_dynamic_index ?
 				exp.chain[i].index :
 				emit_constant(exp.chain[i].index)); // Indexes
 
-		access_chain->type = convert_type(exp.chain[i - 1].to, true, storage); // Last type is the result
-		return access_chain->result;
+		access_chain.set_type(convert_type(exp.chain[i - 1].to, true, storage)); // Last type is the result
+		return access_chain.result;
 	}
 
 	id   emit_constant(uint32_t value)
@@ -1653,15 +1915,9 @@ private:
 	id   emit_constant(const type &type, const constant &data, bool spec_constant)
 	{
 		if (!spec_constant) // Specialization constants cannot reuse other constants
-			if (auto it = std::find_if(_constant_lookup.begin(), _constant_lookup.end(), [&type, &data](auto &x) {
-				if (!(std::get<0>(x) == type && std::memcmp(&std::get<1>(x).as_uint[0], &data.as_uint[0], sizeof(uint32_t) * 16) == 0 && std::get<1>(x).array_data.size() == data.array_data.size()))
-					return false;
-				for (size_t i = 0; i < data.array_data.size(); ++i)
-					if (std::memcmp(&std::get<1>(x).array_data[i].as_uint[0], &data.array_data[i].as_uint[0], sizeof(uint32_t) * 16) != 0)
-						return false;
-				return true;
-			}); it != _constant_lookup.end())
-				return std::get<2>(*it); // Re-use existing constant instead of duplicating the definition
+			if (const auto it = _constant_lookup.find({ type, data });
+				it != _constant_lookup.end())
+				return it->second; // Re-use existing constant instead of duplicating the definition
 
 		spv::Id result;
 		if (type.is_array())
@@ -1717,7 +1973,7 @@ private:
 			}
 			else
 			{
-				spirv_instruction &node = add_instruction(spec_constant ? spv::OpSpecConstantComposite : spv::OpConstantComposite, convert_type(type), _types_and_constants);
+				spirv_instruction node = add_instruction(spec_constant ? spv::OpSpecConstantComposite : spv::OpConstantComposite, convert_type(type), _types_and_constants);
 				for (unsigned int i = 0; i < type.rows; ++i)
 					node.add(rows[i]);
 
@@ -1743,7 +1999,7 @@ private:
 		if (spec_constant) // Keep track of all specialization constants
 			_spec_constants.insert(result);
 		else
-			_constant_lookup.push_back({ type, data, result });
+			_constant_lookup.emplace(constant_lookup { type, data }, result);
 
 		return result;
 	}
@@ -1769,7 +2025,7 @@ private:
 
 		add_location(loc, *_current_block_data);
 
-		spirv_instruction &inst = add_instruction(spv_op, convert_type(type));
+		spirv_instruction inst = add_instruction(spv_op, convert_type(type));
 		inst.add(val); // Operand
 
 		return inst.result;
@@ -1879,7 +2135,7 @@ private:
 					.add(row)
 					.result;
 
-				spirv_instruction &inst = add_instruction(spv_op, convert_type(vector_type));
+				spirv_instruction inst = add_instruction(spv_op, convert_type(vector_type));
 				inst.add(lhs_elem); // Operand 1
 				inst.add(rhs_elem); // Operand 2
 
@@ -1891,14 +2147,14 @@ private:
 				ids.push_back(inst.result);
 			}
 
-			spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(res_type));
+			spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(res_type));
 			inst.add(ids.begin(), ids.end());
 
 			return inst.result;
 		}
 		else
 		{
-			spirv_instruction &inst = add_instruction(spv_op, convert_type(res_type));
+			spirv_instruction inst = add_instruction(spv_op, convert_type(res_type));
 			inst.add(lhs); // Operand 1
 			inst.add(rhs); // Operand 2
 
@@ -1917,7 +2173,7 @@ private:
 
 		add_location(loc, *_current_block_data);
 
-		spirv_instruction &inst = add_instruction(spv::OpSelect, convert_type(type));
+		spirv_instruction inst = add_instruction(spv::OpSelect, convert_type(type));
 		inst.add(condition); // Condition
 		inst.add(true_value); // Object 1
 		inst.add(false_value); // Object 2
@@ -1933,7 +2189,7 @@ private:
 		add_location(loc, *_current_block_data);
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpFunctionCall
-		spirv_instruction &inst = add_instruction(spv::OpFunctionCall, convert_type(res_type));
+		spirv_instruction inst = add_instruction(spv::OpFunctionCall, convert_type(res_type));
 		inst.add(function); // Function
 		for (const expression &arg : args)
 			inst.add(arg.base); // Arguments
@@ -1983,7 +2239,7 @@ private:
 			// Turn the list of scalar arguments into a list of column vectors
 			for (size_t arg = 0; arg < args.size(); arg += vector_type.rows)
 			{
-				spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(vector_type));
+				spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(vector_type));
 				for (unsigned row = 0; row < vector_type.rows; ++row)
 					inst.add(args[arg + row].base);
 
@@ -1999,7 +2255,7 @@ private:
 				ids.push_back(arg.base);
 		}
 
-		spirv_instruction &inst = add_instruction(spv::OpCompositeConstruct, convert_type(type));
+		spirv_instruction inst = add_instruction(spv::OpCompositeConstruct, convert_type(type));
 		inst.add(ids.begin(), ids.end());
 
 		return inst.result;
@@ -2007,50 +2263,58 @@ private:
 
 	void emit_if(const location &loc, id, id condition_block, id true_statement_block, id false_statement_block, unsigned int selection_control) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->split_back();
+		assert(merge_label.front().op == spv::OpLabel);
 
 		// Add previous block containing the condition value first
-		_current_block_data->append(_block_data[condition_block]);
+		_current_block_data->append(std::move(_block_data[condition_block]));
 
-		spirv_instruction branch_inst = _current_block_data->instructions.back();
-		assert(branch_inst.op == spv::OpBranchConditional);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block branch_inst = _current_block_data->split_back();
+		assert(branch_inst.front().op == spv::OpBranchConditional);
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpSelectionMerge)
-			.add(merge_label.result)
+			.add(merge_label.front().result)
 			.add(selection_control & 0x3); // 'SelectionControl' happens to match the flags produced by the parser
 
 		// Append all blocks belonging to the branch
-		_current_block_data->instructions.push_back(branch_inst);
-		_current_block_data->append(_block_data[true_statement_block]);
-		_current_block_data->append(_block_data[false_statement_block]);
+		_current_block_data->append(std::move(branch_inst));
+		_current_block_data->append(std::move(_block_data[true_statement_block]));
+		_current_block_data->append(std::move(_block_data[false_statement_block]));
+
+		_current_block_data->append(std::move(merge_label));
+	}
+	void emit_block(const location &, id prev_block, id statement_block) override
+	{
+		spirv_basic_block merge_label = _current_block_data->split_back();
+		assert(merge_label.front().op == spv::OpLabel);
+
+		// Blocks connected through unconditional branches do not need any structured control flow instructions
+		_current_block_data->append(std::move(_block_data[prev_block]));
+		_current_block_data->append(std::move(_block_data[statement_block]));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 	id   emit_phi(const location &loc, id, id condition_block, id true_value, id true_statement_block, id false_value, id false_statement_block, const type &type) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->split_back();
+		assert(merge_label.front().op == spv::OpLabel);
 
 		// Add previous block containing the condition value first
-		_current_block_data->append(_block_data[condition_block]);
+		_current_block_data->append(std::move(_block_data[condition_block]));
 
 		if (true_statement_block != condition_block)
-			_current_block_data->append(_block_data[true_statement_block]);
+			_current_block_data->append(std::move(_block_data[true_statement_block]));
 		if (false_statement_block != condition_block)
-			_current_block_data->append(_block_data[false_statement_block]);
+			_current_block_data->append(std::move(_block_data[false_statement_block]));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 
 		add_location(loc, *_current_block_data);
 
 		// https://www.khronos.org/registry/spir-v/specs/unified1/SPIRV.html#OpPhi
-		spirv_instruction &inst = add_instruction(spv::OpPhi, convert_type(type))
+		spirv_instruction inst = add_instruction(spv::OpPhi, convert_type(type))
 			.add(true_value) // Variable 0
 			.add(true_statement_block) // Parent 0
 			.add(false_value) // Variable 1
@@ -2060,76 +2324,73 @@ private:
 	}
 	void emit_loop(const location &loc, id, id prev_block, id header_block, id condition_block, id loop_block, id continue_block, unsigned int loop_control) override
 	{
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->split_back();
+		assert(merge_label.front().op == spv::OpLabel);
 
 		// Add previous block first
-		_current_block_data->append(_block_data[prev_block]);
+		_current_block_data->append(std::move(_block_data[prev_block]));
 
 		// Fill header block
-		assert(_block_data[header_block].instructions.size() == 2);
-		_current_block_data->instructions.push_back(_block_data[header_block].instructions[0]);
-		assert(_current_block_data->instructions.back().op == spv::OpLabel);
+		assert(_block_data[header_block].size() == 2);
+		_current_block_data->append_instruction(_block_data[header_block], 0);
+		assert(_current_block_data->back().op == spv::OpLabel);
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpLoopMerge)
-			.add(merge_label.result)
+			.add(merge_label.front().result)
 			.add(continue_block)
 			.add(loop_control & 0x3); // 'LoopControl' happens to match the flags produced by the parser
 
-		_current_block_data->instructions.push_back(_block_data[header_block].instructions[1]);
-		assert(_current_block_data->instructions.back().op == spv::OpBranch);
+		_current_block_data->append_instruction(_block_data[header_block], 1);
+		assert(_current_block_data->back().op == spv::OpBranch);
 
 		// Add condition block if it exists
 		if (condition_block != 0)
-			_current_block_data->append(_block_data[condition_block]);
+			_current_block_data->append(std::move(_block_data[condition_block]));
 
 		// Append loop body block before continue block
-		_current_block_data->append(_block_data[loop_block]);
-		_current_block_data->append(_block_data[continue_block]);
+		_current_block_data->append(std::move(_block_data[loop_block]));
+		_current_block_data->append(std::move(_block_data[continue_block]));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 	void emit_switch(const location &loc, id, id selector_block, id default_label, id default_block, const std::vector<id> &case_literal_and_labels, const std::vector<id> &case_blocks, unsigned int selection_control) override
 	{
 		assert(case_blocks.size() == case_literal_and_labels.size() / 2);
 
-		spirv_instruction merge_label = _current_block_data->instructions.back();
-		assert(merge_label.op == spv::OpLabel);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block merge_label = _current_block_data->split_back();
+		assert(merge_label.front().op == spv::OpLabel);
 
 		// Add previous block containing the selector value first
-		_current_block_data->append(_block_data[selector_block]);
+		_current_block_data->append(std::move(_block_data[selector_block]));
 
-		spirv_instruction switch_inst = _current_block_data->instructions.back();
-		assert(switch_inst.op == spv::OpSwitch);
-		_current_block_data->instructions.pop_back();
+		spirv_basic_block switch_inst = _current_block_data->split_back();
+		assert(switch_inst.front().op == spv::OpSwitch);
 
 		// Add structured control flow instruction
 		add_location(loc, *_current_block_data);
 		add_instruction_without_result(spv::OpSelectionMerge)
-			.add(merge_label.result)
+			.add(merge_label.front().result)
 			.add(selection_control & 0x3); // 'SelectionControl' happens to match the flags produced by the parser
 
 		// Update switch instruction to contain all case labels
-		switch_inst.operands[1] = default_label;
-		switch_inst.add(case_literal_and_labels.begin(), case_literal_and_labels.end());
+		switch_inst.front().set_operand(1, default_label);
+		switch_inst.front().add(case_literal_and_labels.begin(), case_literal_and_labels.end());
 
 		// Append all blocks belonging to the switch
-		_current_block_data->instructions.push_back(switch_inst);
+		_current_block_data->append(std::move(switch_inst));
 
 		std::vector<id> blocks = case_blocks;
-		if (default_label != merge_label.result)
+		if (default_label != merge_label.front().result)
 			blocks.push_back(default_block);
 		// Eliminate duplicates (because of multiple case labels pointing to the same block)
 		std::sort(blocks.begin(), blocks.end());
 		blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
 		for (const id case_block : blocks)
-			_current_block_data->append(_block_data[case_block]);
+			_current_block_data->append(std::move(_block_data[case_block]));
 
-		_current_block_data->instructions.push_back(merge_label);
+		_current_block_data->append(std::move(merge_label));
 	}
 
 	bool is_in_function() const override { return _current_function != nullptr; }
@@ -2150,8 +2411,7 @@ private:
 
 		set_block(id);
 
-		add_instruction_without_result(spv::OpLabel)
-			.result = id;
+		_current_block_data->add(spv::OpLabel, 0, id);
 	}
 	id   leave_block_and_kill() override
 	{
@@ -2232,7 +2492,7 @@ private:
 	{
 		assert(is_in_function()); // Can only leave if there was a function to begin with
 
-		_current_function->definition = _block_data[_last_block];
+		_current_function->definition = std::move(_block_data[_last_block]);
 
 		// Append function end instruction
 		add_instruction_without_result(spv::OpFunctionEnd, _current_function->definition);
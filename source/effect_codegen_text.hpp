@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "effect_module.hpp"
+#include <string>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <algorithm> // std::min
+#include <memory_resource>
+
+namespace reshadefx
+{
+	/// <summary>
+	/// A block of generated source code, as used by the HLSL and GLSL code generators.
+	/// Nested blocks are not copied into their parent when appended, but only referenced, so that the code is concatenated exactly once at the very end.
+	/// </summary>
+	class text_block
+	{
+	public:
+		using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+		explicit text_block(const allocator_type &alloc = {}) : _text(alloc), _references(alloc), _substitution(alloc) {}
+
+		text_block(const text_block &other) = default;
+		text_block(const text_block &other, const allocator_type &alloc) :
+			_text(other._text, alloc), _references(other._references, alloc), _indentation(other._indentation), _has_content(other._has_content), _substitution(other._substitution, alloc), _substitution_anchor(other._substitution_anchor) {}
+		text_block(text_block &&other) = default;
+		text_block(text_block &&other, const allocator_type &alloc) :
+			_text(std::move(other._text), alloc), _references(std::move(other._references), alloc), _indentation(other._indentation), _has_content(other._has_content), _substitution(std::move(other._substitution), alloc), _substitution_anchor(other._substitution_anchor) {}
+
+		/// <summary>
+		/// Checks whether this block would produce any code.
+		/// </summary>
+		bool empty() const { return !_has_content; }
+
+		text_block &operator+=(char c)
+		{
+			_text += c;
+			_has_content = true;
+			return *this;
+		}
+		text_block &operator+=(std::string_view text)
+		{
+			_text += text;
+			_has_content |= !text.empty();
+			return *this;
+		}
+		/// <summary>
+		/// Appends a reference to another block, which must not change anymore afterwards (except for its indentation level).
+		/// </summary>
+		text_block &operator+=(const text_block &block)
+		{
+			assert(&block != this);
+			if (block.empty())
+				return *this;
+
+			_references.push_back({ _text.size(), &block, 0 });
+			_has_content = true;
+			return *this;
+		}
+
+		/// <summary>
+		/// Appends a reference to another block like the operator above, but even if that block is still empty, so that code can be added to it until this block is written out.
+		/// </summary>
+		void append_deferred(const text_block &block)
+		{
+			assert(&block != this);
+			_references.push_back({ _text.size(), &block, 0 });
+		}
+
+		/// <summary>
+		/// Appends a placeholder for the code of a continue block, which is filled in via <see cref="set_continue_substitution"/> once that is known.
+		/// </summary>
+		void append_continue(const text_block &continue_block, uint32_t continue_id)
+		{
+			_references.push_back({ _text.size(), &continue_block, continue_id });
+			_has_content = true;
+		}
+		/// <summary>
+		/// Sets the code that replaces all continue placeholders referencing this block.
+		/// The substituted code was already indented for its position in the <paramref name="anchor"/> block, so only indentation applied to that block and the blocks containing it affects it further.
+		/// </summary>
+		void set_continue_substitution(std::string_view code, const text_block &anchor)
+		{
+			_substitution = code;
+			_substitution_anchor = &anchor;
+		}
+
+		/// <summary>
+		/// Removes the last character of this block.
+		/// </summary>
+		void pop_back()
+		{
+			assert(!_text.empty() && (_references.empty() || _references.back().offset < _text.size()));
+			_text.pop_back();
+		}
+
+		/// <summary>
+		/// Indents every line of this block that starts with a tab character by another tab.
+		/// This is deferred until the code is written out, so it takes constant time no matter how much code is in the block.
+		/// </summary>
+		void increase_indentation_level()
+		{
+			_indentation++;
+		}
+
+		/// <summary>
+		/// Writes out the full code of this block and all blocks it references to the specified string.
+		/// </summary>
+		template <typename string_type>
+		void write(string_type &output) const
+		{
+			size_t size = 0;
+			render([&size](char) { size++; });
+
+			output.reserve(output.size() + size);
+			render([&output](char c) { output += c; });
+		}
+		/// <summary>
+		/// Returns the full code of this block and all blocks it references as a single string.
+		/// </summary>
+		std::string str() const
+		{
+			std::string result;
+			write(result);
+			return result;
+		}
+
+	private:
+		struct reference
+		{
+			size_t offset;
+			const text_block *block;
+			uint32_t continue_id;
+		};
+
+		template <typename F>
+		void render(F emit) const;
+
+		std::pmr::string _text;
+		std::pmr::vector<reference> _references;
+		unsigned int _indentation = 0;
+		bool _has_content = false;
+		std::pmr::string _substitution;
+		const text_block *_substitution_anchor = nullptr;
+	};
+
+	/// <summary>
+	/// Preprocessor conditions around the code of functions and resources, so that compiling the module for an entry point (with "ENTRY_POINT_name" defined) skips everything that entry point does not reference.
+	/// Which entry points exist is only known at the end, so the conditions are filled in when the result is written.
+	/// </summary>
+	class entry_point_guards
+	{
+	public:
+		/// <summary>
+		/// Begins the guarded code of the specified function or resource definition in <paramref name="code"/>.
+		/// </summary>
+		void begin(text_block &code, uint32_t definition)
+		{
+			code.append_deferred(_guards[definition].begin);
+		}
+		/// <summary>
+		/// Ends the guarded code of the specified definition in <paramref name="code"/>, if it was begun.
+		/// </summary>
+		void end(text_block &code, uint32_t definition)
+		{
+			if (const auto it = _guards.find(definition); it != _guards.end())
+				code.append_deferred(it->second.end);
+		}
+
+		/// <summary>
+		/// Marks the specified function and all functions and resources it references as referenced by the entry point with the specified name.
+		/// </summary>
+		void add_entry_point(const std::string &entry_point, const function_info &func)
+		{
+			_guards[func.definition].entry_points.push_back(entry_point);
+
+			for (const uint32_t id : func.referenced_functions)
+				_guards[id].entry_points.push_back(entry_point);
+			for (const uint32_t id : func.referenced_samplers)
+				_guards[id].entry_points.push_back(entry_point);
+			for (const uint32_t id : func.referenced_storages)
+				_guards[id].entry_points.push_back(entry_point);
+		}
+
+		/// <summary>
+		/// Writes the conditions of all guards. Code referenced by every entry point is not guarded at all.
+		/// </summary>
+		/// <param name="num_entry_points">The total number of entry points in the module.</param>
+		void write_conditions(size_t num_entry_points)
+		{
+			for (auto &[definition, guard] : _guards)
+			{
+				if (guard.entry_points.size() == num_entry_points && num_entry_points != 0)
+					continue;
+
+				guard.begin += "#if ";
+				if (guard.entry_points.empty())
+					guard.begin += '0';
+				for (size_t i = 0; i < guard.entry_points.size(); ++i)
+					guard.begin += (i != 0 ? " || defined(ENTRY_POINT_" : "defined(ENTRY_POINT_") + guard.entry_points[i] + ')';
+				guard.begin += '\n';
+
+				guard.end += "#endif\n";
+			}
+		}
+
+	private:
+		struct guard
+		{
+			text_block begin, end;
+			std::vector<std::string> entry_points;
+		};
+
+		std::unordered_map<uint32_t, guard> _guards;
+	};
+
+	template <typename F>
+	void text_block::render(F emit) const
+	{
+		// Increasing the indentation level of a block inserts a tab at its beginning and after every new line that is followed by a tab
+		// For every such pair of characters, the number of inserted tabs is therefore the sum of the indentation levels of all blocks that already contained both characters when their level was increased
+		// Since the blocks are walked depth-first, that is the indentation up to the shallowest block that was visited between the new line and the tab
+		struct frame
+		{
+			const text_block *block;
+			size_t text_offset;
+			size_t reference_index;
+			unsigned int indentation;
+		};
+
+		std::vector<frame> stack;
+		bool after_new_line = false;
+		size_t new_line_depth = 0;
+
+		const auto emit_text = [&](const char *text, size_t length, size_t depth) {
+			for (size_t i = 0; i < length; ++i)
+			{
+				const char c = text[i];
+
+				if (after_new_line)
+				{
+					new_line_depth = std::min(new_line_depth, depth);
+
+					if (c == '\t')
+						for (unsigned int k = 0; k < stack[new_line_depth].indentation; ++k)
+							emit('\t');
+				}
+
+				emit(c);
+
+				after_new_line = (c == '\n');
+				if (after_new_line)
+					new_line_depth = depth;
+			}
+		};
+		const auto push_block = [&](const text_block *block, unsigned int indentation) {
+			indentation += block->_indentation;
+			stack.push_back({ block, 0, 0, indentation });
+
+			// Tabs inserted at the beginning of the block
+			for (unsigned int k = 0; k < block->_indentation; ++k)
+				emit_text("\t", 1, stack.size() - 1);
+		};
+
+		if (_has_content)
+			push_block(this, 0);
+
+		while (!stack.empty())
+		{
+			const size_t depth = stack.size() - 1;
+			frame &current = stack.back();
+			const text_block &block = *current.block;
+
+			const size_t end_offset = current.reference_index < block._references.size() ? block._references[current.reference_index].offset : block._text.size();
+			emit_text(block._text.data() + current.text_offset, end_offset - current.text_offset, depth);
+			current.text_offset = end_offset;
+
+			if (current.reference_index == block._references.size())
+			{
+				stack.pop_back();
+				if (after_new_line && !stack.empty())
+					new_line_depth = std::min(new_line_depth, stack.size() - 1);
+				continue;
+			}
+
+			const reference &ref = block._references[current.reference_index++];
+
+			if (ref.continue_id == 0)
+			{
+				if (!ref.block->empty())
+					push_block(ref.block, current.indentation);
+				continue;
+			}
+
+			if (ref.block->_substitution_anchor == nullptr)
+			{
+				// Keep placeholder as is when the loop this continue belongs to was not emitted yet
+				const std::string placeholder = "__CONTINUE__" + std::to_string(ref.continue_id);
+				emit_text(placeholder.data(), placeholder.size(), depth);
+				continue;
+			}
+
+			// Substituted code behaves as if it was part of the anchor block, so find where that is in the stack
+			size_t anchor_depth = depth;
+			while (anchor_depth != 0 && stack[anchor_depth].block != ref.block->_substitution_anchor)
+				anchor_depth--;
+			assert(stack[anchor_depth].block == ref.block->_substitution_anchor);
+
+			if (after_new_line)
+				new_line_depth = std::min(new_line_depth, anchor_depth);
+			emit_text(ref.block->_substitution.data(), ref.block->_substitution.size(), anchor_depth);
+			// Characters following the substitution are only adjacent to it since it was inserted
+			if (after_new_line)
+				new_line_depth = std::min(new_line_depth, anchor_depth);
+		}
+	}
+}
@@ -564,3 +564,137 @@ bool reshadefx::expression::evaluate_constant_expression(reshadefx::tokenid op,
 
 	return true;
 }
+bool reshadefx::expression::evaluate_constant_intrinsic(const std::string &name, const std::vector<reshadefx::constant> &args)
+{
+	if (!is_constant || type.is_array())
+		return false;
+
+	reshadefx::constant result = {};
+
+	if (type.is_floating_point())
+	{
+		float(*op)(float, float, float) = nullptr;
+
+		if (args.size() == 0)
+		{
+			if (name == "abs")
+				op = [](float x, float, float) { return std::abs(x); };
+			else if (name == "sign")
+				op = [](float x, float, float) { return static_cast<float>((x > 0.0f) - (x < 0.0f)); };
+			else if (name == "floor")
+				op = [](float x, float, float) { return std::floor(x); };
+			else if (name == "ceil")
+				op = [](float x, float, float) { return std::ceil(x); };
+			else if (name == "frac")
+				op = [](float x, float, float) { return x - std::floor(x); };
+			else if (name == "saturate")
+				op = [](float x, float, float) { return std::min(std::max(x, 0.0f), 1.0f); };
+			else if (name == "sqrt")
+				op = [](float x, float, float) { return std::sqrt(x); };
+			else if (name == "rsqrt")
+				op = [](float x, float, float) { return 1.0f / std::sqrt(x); };
+			else if (name == "rcp")
+				op = [](float x, float, float) { return 1.0f / x; };
+			else if (name == "exp")
+				op = [](float x, float, float) { return std::exp(x); };
+			else if (name == "exp2")
+				op = [](float x, float, float) { return std::exp2(x); };
+			else if (name == "log")
+				op = [](float x, float, float) { return std::log(x); };
+			else if (name == "log2")
+				op = [](float x, float, float) { return std::log2(x); };
+			else if (name == "sin")
+				op = [](float x, float, float) { return std::sin(x); };
+			else if (name == "cos")
+				op = [](float x, float, float) { return std::cos(x); };
+			else if (name == "radians")
+				op = [](float x, float, float) { return x * (3.14159265358979323846f / 180.0f); };
+			else if (name == "degrees")
+				op = [](float x, float, float) { return x * (180.0f / 3.14159265358979323846f); };
+		}
+		else if (args.size() == 1)
+		{
+			if (name == "min")
+				op = [](float x, float y, float) { return std::min(x, y); };
+			else if (name == "max")
+				op = [](float x, float y, float) { return std::max(x, y); };
+			else if (name == "step")
+				op = [](float y, float x, float) { return x >= y ? 1.0f : 0.0f; };
+			else if (name == "pow")
+				// Power is implemented as 'exp2(y * log2(x))' on the GPU, so only fold it where that gives the same result
+				op = [](float x, float y, float) { return x > 0.0f ? std::pow(x, y) : std::numeric_limits<float>::quiet_NaN(); };
+		}
+		else if (args.size() == 2)
+		{
+			if (name == "clamp")
+				op = [](float x, float min_value, float max_value) { return std::min(std::max(x, min_value), max_value); };
+			else if (name == "lerp")
+				op = [](float x, float y, float s) { return x + s * (y - x); };
+		}
+
+		if (op == nullptr)
+			return false;
+
+		for (unsigned int i = 0; i < type.components(); ++i)
+		{
+			const float x = constant.as_float[i];
+			const float y = args.size() > 0 ? args[0].as_float[i] : 0.0f;
+			const float z = args.size() > 1 ? args[1].as_float[i] : 0.0f;
+
+			result.as_float[i] = op(x, y, z);
+
+			// Leave special values to the GPU, where their handling may differ from the host
+			if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z) || !std::isfinite(result.as_float[i]))
+				return false;
+		}
+	}
+	else if (type.is_integral() && type.is_signed())
+	{
+		int32_t(*op)(int32_t, int32_t, int32_t) = nullptr;
+
+		if (args.size() == 0)
+		{
+			if (name == "abs")
+				op = [](int32_t x, int32_t, int32_t) { return x < 0 ? static_cast<int32_t>(0u - static_cast<uint32_t>(x)) : x; };
+			else if (name == "sign")
+				op = [](int32_t x, int32_t, int32_t) { return static_cast<int32_t>((x > 0) - (x < 0)); };
+		}
+		else if (args.size() == 1)
+		{
+			if (name == "min")
+				op = [](int32_t x, int32_t y, int32_t) { return std::min(x, y); };
+			else if (name == "max")
+				op = [](int32_t x, int32_t y, int32_t) { return std::max(x, y); };
+		}
+		else if (args.size() == 2)
+		{
+			if (name == "clamp")
+				op = [](int32_t x, int32_t min_value, int32_t max_value) { return std::min(std::max(x, min_value), max_value); };
+		}
+
+		if (op == nullptr)
+			return false;
+
+		for (unsigned int i = 0; i < type.components(); ++i)
+			result.as_int[i] = op(
+				constant.as_int[i],
+				args.size() > 0 ? args[0].as_int[i] : 0,
+				args.size() > 1 ? args[1].as_int[i] : 0);
+	}
+	else if (type.is_integral())
+	{
+		if (args.size() != 2 || name != "clamp")
+			return false;
+
+		for (unsigned int i = 0; i < type.components(); ++i)
+			result.as_uint[i] = std::min(std::max(constant.as_uint[i], args[0].as_uint[i]), args[1].as_uint[i]);
+	}
+	else
+	{
+		return false;
+	}
+
+	std::memcpy(constant.as_uint, result.as_uint, sizeof(constant.as_uint));
+
+	return true;
+}
@@ -215,5 +215,11 @@ namespace reshadefx
 		/// <param name="op">The binary operator to apply.</param>
 		/// <param name="rhs">The constant to use as right-hand side of the binary operation.</param>
 		bool evaluate_constant_expression(reshadefx::tokenid op, const reshadefx::constant &rhs);
+		/// <summary>
+		/// Apply an element-wise intrinsic function to this constant expression, which is the first argument of the call.
+		/// </summary>
+		/// <param name="name">The name of the intrinsic function.</param>
+		/// <param name="args">The constants to use as the remaining arguments, which have to be of the same type as this expression.</param>
+		bool evaluate_constant_intrinsic(const std::string &name, const std::vector<reshadefx::constant> &args);
 	};
 }
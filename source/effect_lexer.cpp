@@ -7,6 +7,17 @@
 #include <cassert>
 #include <unordered_map> // Used for static lookup tables
 
+// SSE2 is available on all x64 processors and enabled by default for x86 builds, so can use it to scan through the input 16 characters at a time
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define RESHADEFX_LEXER_SSE2 1
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#include <intrin.h> // _BitScanForward
+	#endif
+#else
+	#define RESHADEFX_LEXER_SSE2 0
+#endif
+
 using namespace reshadefx;
 
 enum token_type
@@ -495,6 +506,94 @@ static long long octal_to_decimal(long long n)
 	return n;
 }
 
+#if RESHADEFX_LEXER_SSE2
+static inline unsigned int find_first_set_bit(unsigned int mask)
+{
+	assert(mask != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+static inline __m128i match_chars(__m128i chars, char c)
+{
+	return _mm_cmpeq_epi8(chars, _mm_set1_epi8(c));
+}
+static inline __m128i match_chars_in_range(__m128i chars, char first, char last)
+{
+	// Characters outside the ASCII range are negative and therefore never match
+	return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(static_cast<char>(first - 1))), _mm_cmplt_epi8(chars, _mm_set1_epi8(static_cast<char>(last + 1))));
+}
+#endif
+
+/// <summary>
+/// Returns a pointer to the first character in the range [<paramref name="begin"/>, <paramref name="end"/>) for which <paramref name="is_stop_char"/> returns <c>true</c>, or <paramref name="end"/> if there is none.
+/// The <paramref name="match_stop_chars"/> function does the same check for a whole block of 16 characters at once and returns a mask with the bits of all matching characters set.
+/// </summary>
+template <typename S, typename V>
+static inline const char *find_first_matching(const char *begin, const char *end, S is_stop_char, V match_stop_chars)
+{
+#if RESHADEFX_LEXER_SSE2
+	for (; end - begin >= 16; begin += 16)
+		if (const unsigned int mask = match_stop_chars(_mm_loadu_si128(reinterpret_cast<const __m128i *>(begin)));
+			mask != 0)
+			return begin + find_first_set_bit(mask);
+#else
+	(void)match_stop_chars;
+#endif
+
+	while (begin < end && !is_stop_char(*begin))
+		begin++;
+	return begin;
+}
+
+static inline const char *find_end_of_space(const char *begin, const char *end)
+{
+	return find_first_matching(begin, end,
+		[](char c) { return type_lookup[uint8_t(c)] != SPACE; },
+		[](auto chars) {
+#if RESHADEFX_LEXER_SSE2
+			const __m128i space = _mm_or_si128(_mm_or_si128(match_chars(chars, ' '), match_chars(chars, '\t')), match_chars_in_range(chars, '\v', '\r'));
+			return ~static_cast<unsigned int>(_mm_movemask_epi8(space)) & 0xFFFF;
+#else
+			return 0u;
+#endif
+		});
+}
+static inline const char *find_end_of_identifier(const char *begin, const char *end)
+{
+	return find_first_matching(begin, end,
+		[](char c) { return type_lookup[uint8_t(c)] != IDENT && type_lookup[uint8_t(c)] != DIGIT; },
+		[](auto chars) {
+#if RESHADEFX_LEXER_SSE2
+			// Setting the 0x20 bit converts upper case letters to lower case, so only need to check one letter range
+			const __m128i letter = match_chars_in_range(_mm_or_si128(chars, _mm_set1_epi8(0x20)), 'a', 'z');
+			const __m128i ident = _mm_or_si128(_mm_or_si128(letter, match_chars_in_range(chars, '0', '9')), match_chars(chars, '_'));
+			return ~static_cast<unsigned int>(_mm_movemask_epi8(ident)) & 0xFFFF;
+#else
+			return 0u;
+#endif
+		});
+}
+template <char... stop_chars>
+static inline const char *find_first_of(const char *begin, const char *end)
+{
+	return find_first_matching(begin, end,
+		[](char c) { return ((c == stop_chars) || ...); },
+		[](auto chars) {
+#if RESHADEFX_LEXER_SSE2
+			__m128i stop = _mm_setzero_si128();
+			((stop = _mm_or_si128(stop, match_chars(chars, stop_chars))), ...);
+			return static_cast<unsigned int>(_mm_movemask_epi8(stop));
+#else
+			return 0u;
+#endif
+		});
+}
+
 std::string reshadefx::token::id_to_name(tokenid id)
 {
 	const auto it = token_lookup.find(id);
@@ -648,6 +747,11 @@ next_token:
 		{
 			while (_cur < _end)
 			{
+				// Skip over the comment text up to the next character that is of interest
+				skip(find_first_of<'\n', '*'>(_cur, _end) - _cur);
+				if (_cur >= _end)
+					break;
+
 				if (*_cur == '\n')
 				{
 					_cur_location.line++;
@@ -776,28 +880,26 @@ void reshadefx::lexer::skip(size_t length)
 void reshadefx::lexer::skip_space()
 {
 	// Skip each character until a space is found
-	while (type_lookup[uint8_t(*_cur)] == SPACE && _cur < _end)
-		skip(1);
+	skip(find_end_of_space(_cur, _end) - _cur);
 }
 void reshadefx::lexer::skip_to_next_line()
 {
 	// Skip each character until a new line feed is found
-	while (*_cur != '\n' && _cur < _end)
-		skip(1);
+	skip(find_first_of<'\n'>(_cur, _end) - _cur);
 }
 
 void reshadefx::lexer::reset_to_offset(size_t offset)
 {
-	assert(offset < _input.size());
-	_cur = _input.data() + offset;
+	assert(offset < _input->size());
+	_cur = _input->data() + offset;
 }
 
 void reshadefx::lexer::parse_identifier(token &tok) const
 {
-	auto *const begin = _cur, *end = begin;
+	auto *const begin = _cur;
 
 	// Skip to the end of the identifier sequence
-	do end++; while (type_lookup[uint8_t(*end)] == IDENT || type_lookup[uint8_t(*end)] == DIGIT);
+	auto *const end = find_end_of_identifier(begin + 1, _end);
 
 	tok.id = tokenid::identifier;
 	tok.offset = input_offset();
@@ -861,6 +963,15 @@ void reshadefx::lexer::parse_string_literal(token &tok, bool escape)
 
 	for (auto c = *end; c != '"'; c = *++end)
 	{
+		if (const auto run_end = find_first_of<'"', '\n', '\r', '\\'>(end, _end);
+			run_end != end)
+		{
+			// Copy all characters up to the next one that needs special handling at once
+			tok.literal_as_string.append(end, run_end);
+			end = run_end - 1;
+			continue;
+		}
+
 		if (c == '\n' || end >= _end)
 		{
 			// Line feed reached, the string literal is done (technically this should be an error, but the lexer does not report errors, so ignore it)
@@ -6,6 +6,8 @@
 #pragma once
 
 #include "effect_token.hpp"
+#include <memory> // std::shared_ptr
+#include <cassert>
 
 namespace reshadefx
 {
@@ -24,6 +26,22 @@ namespace reshadefx
 			bool ignore_keywords = false,
 			bool escape_string_literals = true,
 			const location &start_location = location()) :
+			lexer(std::make_shared<const std::string>(std::move(input)), ignore_comments, ignore_whitespace, ignore_pp_directives, ignore_line_directives, ignore_keywords, escape_string_literals, start_location)
+		{
+		}
+		/// <summary>
+		/// Construct a lexical analyzer working on an input string that is shared with others (e.g. the contents of a header file included by multiple effects).
+		/// The input string is never modified and is kept alive for as long as any lexer references it.
+		/// </summary>
+		explicit lexer(
+			std::shared_ptr<const std::string> input,
+			bool ignore_comments = true,
+			bool ignore_whitespace = true,
+			bool ignore_pp_directives = true,
+			bool ignore_line_directives = false,
+			bool ignore_keywords = false,
+			bool escape_string_literals = true,
+			const location &start_location = location()) :
 			_input(std::move(input)),
 			_cur_location(start_location),
 			_ignore_comments(ignore_comments),
@@ -33,17 +51,19 @@ namespace reshadefx
 			_ignore_keywords(ignore_keywords),
 			_escape_string_literals(escape_string_literals)
 		{
-			_cur = _input.data();
-			_end = _cur + _input.size();
+			assert(_input != nullptr);
+			_cur = _input->data();
+			_end = _cur + _input->size();
 		}
 
 		lexer(const lexer &lexer) { operator=(lexer); }
 		lexer &operator=(const lexer &lexer)
 		{
+			// Input string is immutable, so can simply share it instead of making a copy
 			_input = lexer._input;
 			_cur_location = lexer._cur_location;
-			reset_to_offset(lexer._cur - lexer._input.data());
-			_end = _input.data() + _input.size();
+			reset_to_offset(lexer._cur - lexer._input->data());
+			_end = _input->data() + _input->size();
 			_ignore_comments = lexer._ignore_comments;
 			_ignore_whitespace = lexer._ignore_whitespace;
 			_ignore_pp_directives = lexer._ignore_pp_directives;
@@ -57,13 +77,13 @@ namespace reshadefx
 		/// <summary>
 		/// Get the current position in the input string.
 		/// </summary>
-		size_t input_offset() const { return _cur - _input.data(); }
+		size_t input_offset() const { return _cur - _input->data(); }
 
 		/// <summary>
 		/// Get the input string this lexical analyzer works on.
 		/// </summary>
-		/// <returns>A constant reference to the input string.</returns>
-		const std::string &input_string() const { return _input; }
+		/// <returns>A view of the input string.</returns>
+		std::string_view input_string() const { return *_input; }
 
 		/// <summary>
 		/// Perform lexical analysis on the input string and return the next token in sequence.
@@ -98,7 +118,7 @@ namespace reshadefx
 		void parse_string_literal(token &tok, bool escape);
 		void parse_numeric_literal(token &tok) const;
 
-		std::string _input;
+		std::shared_ptr<const std::string> _input;
 		location _cur_location;
 		const std::string::value_type *_cur, *_end;
 		bool _ignore_comments;
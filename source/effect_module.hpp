@@ -242,6 +242,11 @@ namespace reshadefx
 	{
 		std::string name;
 		shader_type type;
+		/// <summary>
+		/// Hash of the pre-processed source code this entry point is generated from.
+		/// This covers all code outside of function bodies and the bodies of all functions the entry point references, so it does not change when other functions are modified.
+		/// </summary>
+		uint64_t source_hash = 0;
 	};
 
 	/// <summary>
@@ -257,6 +262,7 @@ namespace reshadefx
 		std::vector<struct_member_info> parameter_list;
 		std::unordered_set<uint32_t> referenced_samplers;
 		std::unordered_set<uint32_t> referenced_storages;
+		std::unordered_set<uint32_t> referenced_functions;
 	};
 
 	/// <summary>
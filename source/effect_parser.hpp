@@ -7,6 +7,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <memory> // std::unique_ptr
+#include <unordered_map>
 
 namespace reshadefx
 {
@@ -75,6 +76,8 @@ namespace reshadefx
 		bool parse_statement(bool scoped);
 		bool parse_statement_block(bool scoped);
 
+		void compute_entry_point_source_hashes();
+
 		codegen *_codegen = nullptr;
 		std::string _errors;
 		token _token, _token_next, _token_backup;
@@ -83,5 +86,7 @@ namespace reshadefx
 		std::vector<uint32_t> _loop_break_target_stack;
 		std::vector<uint32_t> _loop_continue_target_stack;
 		reshadefx::function_info *_current_function = nullptr;
+		std::unordered_map<uint32_t, std::pair<size_t, size_t>> _function_body_ranges;
+		std::vector<std::pair<std::string, uint32_t>> _entry_point_functions;
 	};
 }
@@ -834,91 +834,131 @@ bool reshadefx::parser::parse_expression_unary(expression &exp)
 
 			assert(symbol.function != nullptr);
 
-			std::vector<expression> parameters(arguments.size());
+			// Calls to element-wise intrinsics with only constant arguments can be evaluated at compile time
+			bool is_constant_call = symbol.op == symbol_type::intrinsic && !arguments.empty();
 
-			// We need to allocate some temporary variables to pass in and load results from pointer parameters
-			for (size_t i = 0; i < arguments.size(); ++i)
+			std::vector<constant> constant_args;
+			for (size_t i = 0; is_constant_call && i < arguments.size(); ++i)
 			{
 				const auto &param_type = symbol.function->parameter_list[i].type;
 
-				if (param_type.has(type::q_out) && (arguments[i].type.has(type::q_const) || !arguments[i].is_lvalue))
-					return error(arguments[i].location, 3025, "l-value specifies const object for an 'out' parameter"), false;
+				// Element-wise intrinsics take all arguments in the same type as they return
+				is_constant_call = arguments[i].is_constant && arguments[i].type.components() <= param_type.components() &&
+					param_type.base == symbol.type.base && param_type.rows == symbol.type.rows && param_type.cols == symbol.type.cols;
 
-				if (arguments[i].type.components() > param_type.components())
-					warning(arguments[i].location, 3206, "implicit truncation of vector type");
+				if (is_constant_call && i != 0)
+				{
+					expression arg = arguments[i];
+					arg.add_cast_operation(param_type);
+					constant_args.push_back(std::move(arg.constant));
+				}
+			}
+
+			if (is_constant_call)
+			{
+				expression result = arguments[0];
+				result.add_cast_operation(symbol.function->parameter_list[0].type);
 
-				if (symbol.op == symbol_type::function || param_type.has(type::q_out))
+				is_constant_call = result.evaluate_constant_intrinsic(identifier, constant_args);
+				if (is_constant_call)
+					exp.reset_to_rvalue_constant(location, std::move(result.constant), symbol.type);
+			}
+
+			if (!is_constant_call)
+			{
+				std::vector<expression> parameters(arguments.size());
+
+				// We need to allocate some temporary variables to pass in and load results from pointer parameters
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					if (param_type.is_sampler() || param_type.is_storage() || param_type.has(type::q_groupshared) /* Special case for atomic intrinsics */)
+					const auto &param_type = symbol.function->parameter_list[i].type;
+
+					if (param_type.has(type::q_out) && (arguments[i].type.has(type::q_const) || !arguments[i].is_lvalue))
+						return error(arguments[i].location, 3025, "l-value specifies const object for an 'out' parameter"), false;
+
+					if (arguments[i].type.components() > param_type.components())
+						warning(arguments[i].location, 3206, "implicit truncation of vector type");
+
+					if (symbol.op == symbol_type::function || param_type.has(type::q_out))
 					{
-						if (arguments[i].type != param_type)
-							return error(location, 3004, "no matching intrinsic overload for '" + identifier + '\''), false;
+						if (param_type.is_sampler() || param_type.is_storage() || param_type.has(type::q_groupshared) /* Special case for atomic intrinsics */)
+						{
+							if (arguments[i].type != param_type)
+								return error(location, 3004, "no matching intrinsic overload for '" + identifier + '\''), false;
 
-						assert(arguments[i].is_lvalue);
+							assert(arguments[i].is_lvalue);
 
-						// Do not shadow object or pointer parameters to function calls
-						size_t chain_index = 0;
-						const auto access_chain = _codegen->emit_access_chain(arguments[i], chain_index);
-						parameters[i].reset_to_lvalue(arguments[i].location, access_chain, param_type);
-						assert(chain_index == arguments[i].chain.size());
+							// Do not shadow object or pointer parameters to function calls
+							size_t chain_index = 0;
+							const auto access_chain = _codegen->emit_access_chain(arguments[i], chain_index);
+							parameters[i].reset_to_lvalue(arguments[i].location, access_chain, param_type);
+							assert(chain_index == arguments[i].chain.size());
 
-						// This is referencing a l-value, but want to avoid copying below
-						parameters[i].is_lvalue = false;
+							// This is referencing a l-value, but want to avoid copying below
+							parameters[i].is_lvalue = false;
+						}
+						else
+						{
+							// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
+							const auto temp_variable = _codegen->define_variable(arguments[i].location, param_type);
+							parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
+						}
 					}
 					else
 					{
-						// All user-defined functions actually accept pointers as arguments, same applies to intrinsics with 'out' parameters
-						const auto temp_variable = _codegen->define_variable(arguments[i].location, param_type);
-						parameters[i].reset_to_lvalue(arguments[i].location, temp_variable, param_type);
-					}
-				}
-				else
-				{
-					expression arg = arguments[i];
-					arg.add_cast_operation(param_type);
-					parameters[i].reset_to_rvalue(arg.location, _codegen->emit_load(arg), param_type);
+						expression arg = arguments[i];
+						arg.add_cast_operation(param_type);
+						parameters[i].reset_to_rvalue(arg.location, _codegen->emit_load(arg), param_type);
 
-					// Keep track of whether the parameter is a constant for code generation (this makes the expression invalid for all other uses)
-					parameters[i].is_constant = arg.is_constant;
+						// Keep track of whether the parameter is a constant for code generation (this makes the expression invalid for all other uses)
+						parameters[i].is_constant = arg.is_constant;
+					}
 				}
-			}
 
-			// Copy in parameters from the argument access chains to parameter variables
-			for (size_t i = 0; i < arguments.size(); ++i)
-			{
-				// Only do this for pointer parameters as discovered above
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in) && !parameters[i].type.is_sampler() && !parameters[i].type.is_storage())
+				// Copy in parameters from the argument access chains to parameter variables
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					expression arg = arguments[i];
-					arg.add_cast_operation(parameters[i].type);
-					_codegen->emit_store(parameters[i], _codegen->emit_load(arg));
+					// Only do this for pointer parameters as discovered above
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_in) && !parameters[i].type.is_sampler() && !parameters[i].type.is_storage())
+					{
+						expression arg = arguments[i];
+						arg.add_cast_operation(parameters[i].type);
+						_codegen->emit_store(parameters[i], _codegen->emit_load(arg));
+					}
 				}
-			}
 
-			// Check if the call resolving found an intrinsic or function and invoke the corresponding code
-			const auto result = symbol.op == symbol_type::function ?
-				_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
-				_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
+				// Check if the call resolving found an intrinsic or function and invoke the corresponding code
+				const auto result = symbol.op == symbol_type::function ?
+					_codegen->emit_call(location, symbol.id, symbol.type, parameters) :
+					_codegen->emit_call_intrinsic(location, symbol.id, symbol.type, parameters);
 
-			exp.reset_to_rvalue(location, result, symbol.type);
+				exp.reset_to_rvalue(location, result, symbol.type);
 
-			// Copy out parameters from parameter variables back to the argument access chains
-			for (size_t i = 0; i < arguments.size(); ++i)
-			{
-				// Only do this for pointer parameters as discovered above
-				if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out) && !parameters[i].type.is_sampler() && !parameters[i].type.is_storage())
+				// Copy out parameters from parameter variables back to the argument access chains
+				for (size_t i = 0; i < arguments.size(); ++i)
 				{
-					expression arg = parameters[i];
-					arg.add_cast_operation(arguments[i].type);
-					_codegen->emit_store(arguments[i], _codegen->emit_load(arg));
+					// Only do this for pointer parameters as discovered above
+					if (parameters[i].is_lvalue && parameters[i].type.has(type::q_out) && !parameters[i].type.is_sampler() && !parameters[i].type.is_storage())
+					{
+						expression arg = parameters[i];
+						arg.add_cast_operation(arguments[i].type);
+						_codegen->emit_store(arguments[i], _codegen->emit_load(arg));
+					}
 				}
-			}
 
-			if (_current_function != nullptr)
-			{
-				// Calling a function makes the caller inherit all sampler and storage object references from the callee
-				_current_function->referenced_samplers.insert(symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end());
-				_current_function->referenced_storages.insert(symbol.function->referenced_storages.begin(), symbol.function->referenced_storages.end());
+				if (_current_function != nullptr)
+				{
+					// Calling a function makes the caller inherit all sampler and storage object references from the callee
+					_current_function->referenced_samplers.insert(symbol.function->referenced_samplers.begin(), symbol.function->referenced_samplers.end());
+					_current_function->referenced_storages.insert(symbol.function->referenced_storages.begin(), symbol.function->referenced_storages.end());
+
+					// Same goes for the functions the callee calls, so that the caller references every function it depends on
+					if (symbol.op == symbol_type::function)
+					{
+						_current_function->referenced_functions.insert(symbol.id);
+						_current_function->referenced_functions.insert(symbol.function->referenced_functions.begin(), symbol.function->referenced_functions.end());
+					}
+				}
 			}
 		}
 		else if (symbol.op == symbol_type::invalid)
@@ -1287,6 +1327,22 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs, unsigned int l
 			if (rhs.is_constant && lhs.evaluate_constant_expression(op, rhs.constant))
 				continue;
 
+#if !RESHADEFX_SHORT_CIRCUIT
+			// A constant operand of a logical operation either decides its result already or reduces it to the other operand
+			if ((op == tokenid::ampersand_ampersand || op == tokenid::pipe_pipe) && type.is_scalar() && (lhs.is_constant || rhs.is_constant))
+			{
+				// This is the case for 'false' with '&&' and for 'true' with '||'
+				const bool is_result = ((lhs.is_constant ? lhs : rhs).constant.as_uint[0] != 0) == (op == tokenid::pipe_pipe);
+				if (is_result != lhs.is_constant)
+					lhs = std::move(rhs);
+
+				// The result of an operator is never assignable, even if it reduced to a variable
+				if (lhs.is_lvalue)
+					lhs.reset_to_rvalue(lhs.location, _codegen->emit_load(lhs), lhs.type);
+				continue;
+			}
+#endif
+
 			const auto lhs_value = _codegen->emit_load(lhs);
 
 #if RESHADEFX_SHORT_CIRCUIT
@@ -1385,6 +1441,37 @@ bool reshadefx::parser::parse_expression_multary(expression &lhs, unsigned int l
 			true_exp.add_cast_operation(type);
 			false_exp.add_cast_operation(type);
 
+#if !RESHADEFX_SHORT_CIRCUIT
+			// Select the value at compile time if the condition is constant
+			if (lhs.is_constant)
+			{
+				bool is_uniform_condition = true;
+				for (unsigned int i = 1; i < lhs.type.components(); ++i)
+					is_uniform_condition &= (lhs.constant.as_uint[i] != 0) == (lhs.constant.as_uint[0] != 0);
+
+				if (is_uniform_condition)
+				{
+					lhs = lhs.constant.as_uint[0] != 0 ? std::move(true_exp) : std::move(false_exp);
+
+					// Selecting a variable still only results in its value, not the variable itself
+					if (lhs.is_lvalue)
+						lhs.reset_to_rvalue(lhs.location, _codegen->emit_load(lhs), lhs.type);
+					continue;
+				}
+
+				// Mixed vector conditions can only be evaluated if both values are known too
+				if (true_exp.is_constant && false_exp.is_constant && !type.is_array() && !type.is_matrix())
+				{
+					for (unsigned int i = 0; i < type.components(); ++i)
+						if (lhs.constant.as_uint[i] == 0)
+							true_exp.constant.as_uint[i] = false_exp.constant.as_uint[i];
+
+					lhs = std::move(true_exp);
+					continue;
+				}
+			}
+#endif
+
 			// Load condition value from expression
 			const auto condition_value = _codegen->emit_load(lhs);
 
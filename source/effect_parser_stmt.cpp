@@ -33,8 +33,56 @@ bool reshadefx::parser::parse(std::string input, codegen *backend)
 		if (parse_top(current_success); !current_success)
 			parse_success = false;
 
+	compute_entry_point_source_hashes();
+
 	return parse_success;
 }
+void reshadefx::parser::compute_entry_point_source_hashes()
+{
+	const std::string_view source = _lexer->input_string();
+
+	const auto hash_fnv1a = [](std::string_view data, uint64_t hash) {
+		for (const char c : data)
+			hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+		return hash;
+	};
+
+	// Hash everything outside of function bodies (global declarations, function signatures, techniques, ...), since that affects every entry point
+	std::vector<std::pair<size_t, size_t>> body_ranges;
+	body_ranges.reserve(_function_body_ranges.size());
+	for (const auto &[definition, range] : _function_body_ranges)
+		body_ranges.push_back(range);
+	std::sort(body_ranges.begin(), body_ranges.end());
+
+	uint64_t global_hash = 14695981039346656037ull;
+	size_t offset = 0;
+	for (const auto &[begin, end] : body_ranges)
+	{
+		global_hash = hash_fnv1a(source.substr(offset, begin - offset), global_hash);
+		offset = end;
+	}
+	global_hash = hash_fnv1a(source.substr(offset), global_hash);
+
+	// Then add the bodies of all functions an entry point references, so that modifying any other function does not change its hash
+	for (const auto &[name, definition] : _entry_point_functions)
+	{
+		const function_info &function = _codegen->find_function(definition);
+
+		body_ranges.clear();
+		for (const uint32_t id : function.referenced_functions)
+			if (const auto it = _function_body_ranges.find(id); it != _function_body_ranges.end())
+				body_ranges.push_back(it->second);
+		if (const auto it = _function_body_ranges.find(definition); it != _function_body_ranges.end())
+			body_ranges.push_back(it->second);
+		std::sort(body_ranges.begin(), body_ranges.end());
+
+		uint64_t hash = global_hash;
+		for (const auto &[begin, end] : body_ranges)
+			hash = hash_fnv1a(source.substr(begin, end - begin), hash);
+
+		_codegen->set_entry_point_source_hash(name, hash);
+	}
+}
 void reshadefx::parser::parse_top(bool &parse_success)
 {
 	if (accept(tokenid::namespace_))
@@ -218,8 +266,15 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			// Load condition and convert to boolean value as required by 'OpBranchConditional'
 			condition.add_cast_operation({ type::t_bool, 1, 1 });
 
-			const codegen::id condition_value = _codegen->emit_load(condition);
-			const codegen::id condition_block = _codegen->leave_block_and_branch_conditional(condition_value, true_block, false_block);
+			// Only the branch that is taken is emitted if the condition is known at compile time
+			// The other branch is still parsed to report any errors in it, but its block is never added to the output
+			const bool is_constant_condition = condition.is_constant;
+			const bool constant_condition_result = is_constant_condition && condition.constant.as_uint[0] != 0;
+
+			const codegen::id condition_value = is_constant_condition ? 0 : _codegen->emit_load(condition);
+			const codegen::id condition_block = is_constant_condition ?
+				_codegen->leave_block_and_branch(constant_condition_result ? true_block : false_block) :
+				_codegen->leave_block_and_branch_conditional(condition_value, true_block, false_block);
 
 			{ // Then block of the if statement
 				_codegen->enter_block(true_block);
@@ -241,7 +296,10 @@ bool reshadefx::parser::parse_statement(bool scoped)
 			_codegen->enter_block(merge_block);
 
 			// Emit structured control flow for an if statement and connect all basic blocks
-			_codegen->emit_if(location, condition_value, condition_block, true_block, false_block, selection_control);
+			if (is_constant_condition)
+				_codegen->emit_block(location, condition_block, constant_condition_result ? true_block : false_block);
+			else
+				_codegen->emit_if(location, condition_value, condition_block, true_block, false_block, selection_control);
 
 			return true;
 		}
@@ -1134,9 +1192,13 @@ bool reshadefx::parser::parse_function(type type, std::string name)
 	// A function has to start with a new block
 	_codegen->enter_block(_codegen->create_block());
 
+	const size_t body_begin = _token_next.offset;
+
 	if (!parse_statement_block(false))
 		parse_success = false;
 
+	_function_body_ranges[id] = { body_begin, _token.offset + _token.length };
+
 	// Add implicit return statement to the end of functions
 	if (_codegen->is_in_block())
 		_codegen->leave_block_and_return();
@@ -1607,16 +1669,19 @@ bool reshadefx::parser::parse_technique_pass(pass_info &info)
 							vs_info = function_info;
 							_codegen->define_entry_point(vs_info, shader_type::vs);
 							info.vs_entry_point = vs_info.unique_name;
+							_entry_point_functions.emplace_back(vs_info.unique_name, symbol.id);
 							break;
 						case 'P':
 							ps_info = function_info;
 							_codegen->define_entry_point(ps_info, shader_type::ps);
 							info.ps_entry_point = ps_info.unique_name;
+							_entry_point_functions.emplace_back(ps_info.unique_name, symbol.id);
 							break;
 						case 'C':
 							cs_info = function_info;
 							_codegen->define_entry_point(cs_info, shader_type::cs, num_threads);
 							info.cs_entry_point = cs_info.unique_name;
+							_entry_point_functions.emplace_back(cs_info.unique_name, symbol.id);
 							break;
 						}
 					}
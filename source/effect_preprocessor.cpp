@@ -5,8 +5,9 @@
 
 #include "effect_lexer.hpp"
 #include "effect_preprocessor.hpp"
+#include <mutex>
 #include <cassert>
-#include <algorithm> // std::find_if
+#include <algorithm> // std::find_if, std::sort
 
 #ifndef _WIN32
 	// On Linux systems the native path encoding is UTF-8 already, so no conversion necessary
@@ -97,6 +98,147 @@ static bool read_file(const std::filesystem::path &path, std::string &data)
 	data = file_data;
 	return true;
 }
+static std::shared_ptr<const std::string> read_file_shared(const std::filesystem::path &path)
+{
+	// Keep file contents in a process-wide store that is shared by all preprocessor instances, so that headers included by many effects are only read from disk once
+	// The contents are never modified after being read, so they can be referenced by any number of lexers at the same time without copying
+	struct source_file
+	{
+		std::filesystem::file_time_type modified_at;
+		uintmax_t size;
+		std::shared_ptr<const std::string> data;
+	};
+
+	static std::mutex s_source_files_mutex;
+	static std::unordered_map<std::filesystem::path::string_type, source_file> s_source_files;
+
+	std::error_code ec;
+	const std::filesystem::file_time_type modified_at = std::filesystem::last_write_time(path, ec);
+	if (ec)
+		return nullptr;
+	const uintmax_t size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return nullptr;
+
+	{	const std::lock_guard<std::mutex> lock(s_source_files_mutex);
+
+		if (const auto it = s_source_files.find(path.native());
+			it != s_source_files.end() && it->second.modified_at == modified_at && it->second.size == size)
+			return it->second.data;
+	}
+
+	// Read outside the lock, so that different files can be read in parallel (the rare case of two threads reading the same file at once just means it is read twice)
+	std::string data;
+	if (!read_file(path, data))
+		return nullptr;
+
+	const auto shared_data = std::make_shared<const std::string>(std::move(data));
+
+	{	const std::lock_guard<std::mutex> lock(s_source_files_mutex);
+
+		s_source_files[path.native()] = { modified_at, size, shared_data };
+	}
+
+	return shared_data;
+}
+
+static uint64_t compute_hash(const std::string_view data, uint64_t hash = 14695981039346656037ull)
+{
+	// FNV-1a hash, which is stable across runs and processes
+	for (const char c : data)
+		hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+	return hash;
+}
+
+static bool is_same_macro_table(const std::unordered_map<std::string, reshadefx::preprocessor::macro> &lhs, const std::unordered_map<std::string, reshadefx::preprocessor::macro> &rhs)
+{
+	if (lhs.size() != rhs.size())
+		return false;
+
+	for (const auto &[name, macro] : lhs)
+	{
+		const auto it = rhs.find(name);
+		if (it == rhs.end() ||
+			it->second.replacement_list != macro.replacement_list ||
+			it->second.parameters != macro.parameters ||
+			it->second.is_variadic != macro.is_variadic ||
+			it->second.is_function_like != macro.is_function_like)
+			return false;
+	}
+
+	return true;
+}
+
+/// <summary>
+/// The preprocessor state a file was included under.
+/// Snapshots are only looked up by a hash of this, so it is compared in full before one is restored, to rule out hash collisions.
+/// </summary>
+struct include_conditions
+{
+	std::unordered_map<std::string, reshadefx::preprocessor::macro> macros;
+	std::vector<std::string> pragma_once_files; // Sorted
+	std::vector<std::filesystem::path> include_paths;
+
+	static std::vector<std::string> collect_pragma_once_files(const std::unordered_map<std::string, std::shared_ptr<const std::string>> &file_cache)
+	{
+		std::vector<std::string> files;
+		for (const auto &[path, data] : file_cache)
+			if (data->empty())
+				files.push_back(path);
+		std::sort(files.begin(), files.end());
+		return files;
+	}
+
+	bool matches(const std::unordered_map<std::string, reshadefx::preprocessor::macro> &other_macros, const std::unordered_map<std::string, std::shared_ptr<const std::string>> &other_file_cache, const std::vector<std::filesystem::path> &other_include_paths) const
+	{
+		return other_include_paths == include_paths && collect_pragma_once_files(other_file_cache) == pragma_once_files && is_same_macro_table(other_macros, macros);
+	}
+	bool operator==(const include_conditions &other) const
+	{
+		return other.include_paths == include_paths && other.pragma_once_files == pragma_once_files && is_same_macro_table(other.macros, macros);
+	}
+};
+
+/// <summary>
+/// The state of a preprocessor right after an included file was processed, which can be restored by other preprocessor instances that include the same file under the same conditions.
+/// </summary>
+struct include_snapshot
+{
+	struct file_state
+	{
+		std::string path;
+		std::shared_ptr<const std::string> data;
+		bool pragma_once;
+	};
+
+	std::shared_ptr<const std::string> file_data;
+	uint64_t state_hash;
+	include_conditions conditions;
+	std::string output;
+	reshadefx::location output_location;
+	std::unordered_map<std::string, reshadefx::preprocessor::macro> macros;
+	std::vector<file_state> files;
+	std::vector<std::string> used_macros;
+	std::vector<std::string> referenced_macros;
+};
+
+static std::mutex s_include_snapshots_mutex;
+static std::unordered_map<std::string, std::vector<std::shared_ptr<const include_snapshot>>> s_include_snapshots;
+
+struct reshadefx::preprocessor::include_recording
+{
+	std::string file_path;
+	std::shared_ptr<const std::string> file_data;
+	uint64_t state_hash;
+	include_conditions conditions;
+	size_t input_index;
+	size_t output_offset;
+	size_t errors_offset;
+	size_t if_stack_size;
+	std::vector<include_snapshot::file_state> included_files;
+	std::unordered_set<std::string> outer_used_macros;
+	std::unordered_set<std::string> outer_referenced_macros;
+};
 
 static std::string escape_string(std::string s)
 {
@@ -125,8 +267,8 @@ bool reshadefx::preprocessor::add_macro_definition(const std::string &name, cons
 
 bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 {
-	std::string data;
-	if (!read_file(path, data))
+	std::shared_ptr<const std::string> data = read_file_shared(path);
+	if (data == nullptr)
 		return false;
 
 	_success = true; // Clear success flag before parsing a new file
@@ -134,6 +276,9 @@ bool reshadefx::preprocessor::append_file(const std::filesystem::path &path)
 	push(std::move(data), path.u8string());
 	parse();
 
+	if (_include_recording != nullptr)
+		end_include_recording(false);
+
 	return _success;
 }
 bool reshadefx::preprocessor::append_string(const std::string &source_code)
@@ -149,6 +294,9 @@ bool reshadefx::preprocessor::append_string(const std::string &source_code)
 	push(source_code, "unknown");
 	parse();
 
+	if (_include_recording != nullptr)
+		end_include_recording(false);
+
 	return _success;
 }
 
@@ -171,6 +319,10 @@ std::vector<std::pair<std::string, std::string>> reshadefx::preprocessor::used_m
 			defines.push_back({ name, it->second.replacement_list });
 	return defines;
 }
+std::vector<std::string> reshadefx::preprocessor::referenced_macros() const
+{
+	return std::vector<std::string>(_referenced_macros.begin(), _referenced_macros.end());
+}
 
 void reshadefx::preprocessor::error(const location &location, const std::string &message)
 {
@@ -183,6 +335,10 @@ void reshadefx::preprocessor::warning(const location &location, const std::strin
 }
 
 void reshadefx::preprocessor::push(std::string input, const std::string &name)
+{
+	push(std::make_shared<const std::string>(std::move(input)), name);
+}
+void reshadefx::preprocessor::push(std::shared_ptr<const std::string> input, const std::string &name)
 {
 	location start_location = !name.empty() ?
 		// Start at the beginning of the file when pushing a new file
@@ -220,6 +376,10 @@ bool reshadefx::preprocessor::peek(tokenid token) const
 }
 bool reshadefx::preprocessor::consume()
 {
+	// Finish recording once all tokens of the included file were consumed and processed
+	if (_include_recording != nullptr && _next_input_index < _include_recording->input_index)
+		end_include_recording(true);
+
 	_current_input_index = _next_input_index;
 
 	if (_input_stack.empty())
@@ -306,7 +466,7 @@ bool reshadefx::preprocessor::expect(tokenid token)
 		actual_token.location.source = _output_location.source;
 
 		error(actual_token.location, "syntax error: unexpected token '" +
-			_input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length) + '\'');
+			std::string(_input_stack[_next_input_index].lexer->input_string().substr(actual_token.offset, actual_token.length)) + '\'');
 
 		return false;
 	}
@@ -518,6 +678,8 @@ void reshadefx::preprocessor::parse_ifdef()
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifdef is active
 		_used_macros.emplace(_token.literal_as_string);
+	if (level.value)
+		_referenced_macros.emplace(_token.literal_as_string);
 }
 void reshadefx::preprocessor::parse_ifndef()
 {
@@ -540,6 +702,8 @@ void reshadefx::preprocessor::parse_ifndef()
 	_if_stack.push_back(std::move(level));
 	if (!parent_skipping) // Only add if this #ifndef is active
 		_used_macros.emplace(_token.literal_as_string);
+	if (!level.value)
+		_referenced_macros.emplace(_token.literal_as_string);
 }
 void reshadefx::preprocessor::parse_elif()
 {
@@ -621,7 +785,7 @@ void reshadefx::preprocessor::parse_pragma()
 	if (pragma == "once")
 	{
 		if (const auto it = _file_cache.find(_output_location.source); it != _file_cache.end())
-			it->second.clear();
+			it->second = std::make_shared<const std::string>(); // Replace with empty contents, so that subsequent includes of this file are skipped
 		return;
 	}
 
@@ -667,7 +831,7 @@ void reshadefx::preprocessor::parse_include()
 		return;
 	}
 
-	std::string data;
+	std::shared_ptr<const std::string> data;
 	if (auto it = _file_cache.find(file_path_string);
 		it != _file_cache.end())
 	{
@@ -675,7 +839,7 @@ void reshadefx::preprocessor::parse_include()
 	}
 	else
 	{
-		if (!read_file(file_path, data))
+		if ((data = read_file_shared(file_path)) == nullptr)
 		{
 			error(keyword_location, "could not open included file '" + file_path_string + '\'');
 			consume_until(tokenid::end_of_line);
@@ -685,12 +849,167 @@ void reshadefx::preprocessor::parse_include()
 		_file_cache.emplace(file_path_string, data);
 	}
 
+	// Keep track of all files included while recording, so that their contents can be verified before restoring the snapshot
+	if (_include_recording != nullptr && !data->empty())
+		_include_recording->included_files.push_back({ file_path_string, data, false });
+
+	// Skip processing the file if another preprocessor instance already did so under the same conditions
+	if (!data->empty() && restore_include_snapshot(file_path_string, data))
+		return;
+
 	// Clear out input stack before pushing include so that hidden macros do not bleed into the include
 	while (_input_stack.size() > (_next_input_index + 1))
 		_input_stack.pop_back();
+
+	if (_include_recording == nullptr && !data->empty())
+		begin_include_recording(file_path_string, data);
+
 	push(std::move(data), file_path_string);
 }
 
+uint64_t reshadefx::preprocessor::compute_include_state_hash() const
+{
+	uint64_t hash = 0;
+
+	// Combine hashes of all macros with an addition, so that the result does not depend on the iteration order of the map
+	for (const auto &[name, macro] : _macros)
+	{
+		uint64_t macro_hash = compute_hash(name);
+		macro_hash = compute_hash(macro.replacement_list, compute_hash({ "\0", 1 }, macro_hash));
+		for (const std::string &parameter : macro.parameters)
+			macro_hash = compute_hash(parameter, compute_hash({ "\0", 1 }, macro_hash));
+		macro_hash = compute_hash(macro.is_function_like ? "f" : "o", macro_hash);
+		hash += macro_hash;
+	}
+
+	// Files that were marked with '#pragma once' are skipped when included again, which changes the result of an include
+	for (const auto &[path, data] : _file_cache)
+		if (data->empty())
+			hash += compute_hash(path, compute_hash("once"));
+
+	for (const std::filesystem::path &include_path : _include_paths)
+		hash = compute_hash(include_path.u8string(), hash * 1099511628211ull);
+
+	return hash;
+}
+
+bool reshadefx::preprocessor::restore_include_snapshot(const std::string &file_path, const std::shared_ptr<const std::string> &file_data)
+{
+	const uint64_t state_hash = compute_include_state_hash();
+
+	std::shared_ptr<const include_snapshot> snapshot;
+	{	const std::lock_guard<std::mutex> lock(s_include_snapshots_mutex);
+
+		if (const auto it = s_include_snapshots.find(file_path);
+			it != s_include_snapshots.end())
+		{
+			for (const std::shared_ptr<const include_snapshot> &candidate : it->second)
+			{
+				if (candidate->file_data == file_data && candidate->state_hash == state_hash && candidate->conditions.matches(_macros, _file_cache, _include_paths))
+				{
+					snapshot = candidate;
+					break;
+				}
+			}
+		}
+	}
+
+	if (snapshot == nullptr)
+		return false;
+
+	// Verify that all files included while the snapshot was recorded still have the same contents and would not cause a recursive include here
+	for (const include_snapshot::file_state &file : snapshot->files)
+	{
+		if (std::find_if(_input_stack.begin(), _input_stack.end(),
+			[&file](const input_level &level) { return level.name == file.path; }) != _input_stack.end())
+			return false;
+
+		if (file.data != read_file_shared(std::filesystem::u8path(file.path)))
+			return false;
+	}
+
+	_output += snapshot->output;
+	_output_location = snapshot->output_location;
+	_macros = snapshot->macros;
+
+	for (const include_snapshot::file_state &file : snapshot->files)
+	{
+		if (file.pragma_once)
+			_file_cache[file.path] = std::make_shared<const std::string>();
+		else
+			_file_cache.emplace(file.path, file.data);
+	}
+
+	_used_macros.insert(snapshot->used_macros.begin(), snapshot->used_macros.end());
+	_referenced_macros.insert(snapshot->referenced_macros.begin(), snapshot->referenced_macros.end());
+
+	// Forward to any snapshot recorded for a file that included this one
+	if (_include_recording != nullptr)
+		_include_recording->included_files.insert(_include_recording->included_files.end(), snapshot->files.begin(), snapshot->files.end());
+
+	return true;
+}
+
+void reshadefx::preprocessor::begin_include_recording(const std::string &file_path, const std::shared_ptr<const std::string> &file_data)
+{
+	assert(_include_recording == nullptr);
+
+	_include_recording = std::make_unique<include_recording>();
+	_include_recording->file_path = file_path;
+	_include_recording->file_data = file_data;
+	_include_recording->state_hash = compute_include_state_hash();
+	_include_recording->conditions.macros = _macros;
+	_include_recording->conditions.pragma_once_files = include_conditions::collect_pragma_once_files(_file_cache);
+	_include_recording->conditions.include_paths = _include_paths;
+	_include_recording->input_index = _input_stack.size(); // Index of the input level that is pushed for the file next
+	_include_recording->output_offset = _output.size();
+	_include_recording->errors_offset = _errors.size();
+	_include_recording->if_stack_size = _if_stack.size();
+	_include_recording->included_files.push_back({ file_path, file_data, false });
+
+	// Track macros used by the included file separately, so that exactly those can be added again when restoring the snapshot
+	_include_recording->outer_used_macros = std::move(_used_macros);
+	_used_macros.clear();
+	_include_recording->outer_referenced_macros = std::move(_referenced_macros);
+	_referenced_macros.clear();
+}
+void reshadefx::preprocessor::end_include_recording(bool store_snapshot)
+{
+	const std::unique_ptr<include_recording> recording = std::move(_include_recording);
+
+	// Do not store snapshots of files that caused any errors or warnings, or left unterminated blocks behind
+	if (store_snapshot && _errors.size() == recording->errors_offset && _if_stack.size() == recording->if_stack_size)
+	{
+		const auto snapshot = std::make_shared<include_snapshot>();
+		snapshot->file_data = recording->file_data;
+		snapshot->state_hash = recording->state_hash;
+		snapshot->conditions = std::move(recording->conditions);
+		snapshot->output = _output.substr(recording->output_offset);
+		snapshot->output_location = _output_location;
+		snapshot->macros = _macros;
+		snapshot->used_macros.assign(_used_macros.begin(), _used_macros.end());
+		snapshot->referenced_macros.assign(_referenced_macros.begin(), _referenced_macros.end());
+
+		// A '#pragma once' can only appear in an included file, so only those can have changed state
+		snapshot->files = std::move(recording->included_files);
+		for (include_snapshot::file_state &file : snapshot->files)
+			file.pragma_once = _file_cache.at(file.path)->empty();
+
+		const std::lock_guard<std::mutex> lock(s_include_snapshots_mutex);
+
+		std::vector<std::shared_ptr<const include_snapshot>> &snapshots = s_include_snapshots[recording->file_path];
+		// Remove snapshots of older versions of the file and limit the number of different conditions kept per file
+		snapshots.erase(std::remove_if(snapshots.begin(), snapshots.end(),
+			[&recording, &snapshot](const std::shared_ptr<const include_snapshot> &existing) { return existing->file_data != recording->file_data || (existing->state_hash == snapshot->state_hash && existing->conditions == snapshot->conditions); }), snapshots.end());
+		if (snapshots.size() >= 8)
+			snapshots.erase(snapshots.begin());
+		snapshots.push_back(std::move(snapshot));
+	}
+
+	_used_macros.insert(recording->outer_used_macros.begin(), recording->outer_used_macros.end());
+	_referenced_macros.insert(recording->outer_referenced_macros.begin(), recording->outer_referenced_macros.end());
+}
+
 bool reshadefx::preprocessor::evaluate_expression()
 {
 	struct rpn_token
@@ -876,7 +1195,11 @@ bool reshadefx::preprocessor::evaluate_expression()
 				if (has_parentheses && !expect(tokenid::parenthesis_close))
 					return false;
 
-				rpn[rpn_index++] = { _macros.find(macro_name) != _macros.end() ? 1 : 0, false };
+				const bool is_defined = _macros.find(macro_name) != _macros.end();
+				if (is_defined)
+					_referenced_macros.emplace(macro_name);
+
+				rpn[rpn_index++] = { is_defined ? 1 : 0, false };
 				continue;
 			}
 
@@ -1059,9 +1382,11 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	if (it == _macros.end())
 		return false;
 
-	const std::unordered_set<std::string> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
-	if (hidden_macros.find(_token.literal_as_string) != hidden_macros.end())
-		return false;
+	for (const hidden_macro *hidden = _input_stack[_current_input_index].hidden_macros.get(); hidden != nullptr; hidden = hidden->parent.get())
+		if (hidden->name == _token.literal_as_string)
+			return false;
+
+	_referenced_macros.emplace(it->first);
 
 	const auto macro_location = _token.location;
 	if (_recursion_count++ >= 256)
@@ -1129,7 +1454,8 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 	{
 		push(std::move(input));
 
-		_input_stack[_current_input_index].hidden_macros.insert(it->first);
+		std::shared_ptr<const hidden_macro> &hidden_macros = _input_stack[_current_input_index].hidden_macros;
+		hidden_macros = std::make_shared<const hidden_macro>(hidden_macro { it->first, std::move(hidden_macros) });
 	}
 
 	return true;
@@ -1137,6 +1463,18 @@ bool reshadefx::preprocessor::evaluate_identifier_as_macro()
 
 void reshadefx::preprocessor::expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out)
 {
+	// Parameters that appear multiple times in the replacement list expand to the same text every time, so only expand each argument once
+	// Otherwise the amount of work would grow exponentially with how deeply such macros are nested in each other's arguments
+	struct expanded_argument
+	{
+		bool valid = false;
+		std::string text;
+		unsigned short recursion_count;
+		unsigned int line;
+		bool at_line_begin;
+	};
+	std::vector<expanded_argument> expanded_arguments(arguments.size());
+
 	for (size_t offset = 0; offset < macro.replacement_list.size(); ++offset)
 	{
 		if (macro.replacement_list[offset] != macro_replacement_start)
@@ -1181,18 +1519,54 @@ void reshadefx::preprocessor::expand_macro(const std::string &name, const macro
 			out += '"';
 			break;
 		case macro_replacement_argument:
-			push(arguments[index] + static_cast<char>(macro_replacement_argument));
-			while (true)
+			if (expanded_argument &expanded = expanded_arguments[index];
+				expanded.valid &&
+				// The result only stays the same when expansion starts on the same line (because of '__LINE__') and would not run into the recursion limit this time
+				expanded.line == _token.location.line && expanded.at_line_begin == (_token.location.column <= 1) && _recursion_count + expanded.recursion_count <= 256)
 			{
-				// Consume all tokens here, so spaces are added to the output too
-				consume();
-				if (_token == tokenid::unknown) // 'macro_replacement_argument' is 'tokenid::unknown'
-					break;
-				if (_token == tokenid::identifier && evaluate_identifier_as_macro())
-					continue;
-				out += _current_token_raw_data;
+				out += expanded.text;
+				_recursion_count += expanded.recursion_count;
+
+				// Leave the current token in the same state as expanding the argument again would
+				_token.id = tokenid::unknown;
+				_token.location.column += static_cast<unsigned int>(arguments[index].size());
+				_token.offset = arguments[index].size();
+				_token.length = 1;
+				_token.literal_as_double = 0;
+				_token.literal_as_string.clear();
+				_current_token_raw_data = static_cast<char>(macro_replacement_argument);
+			}
+			else
+			{
+				const size_t out_offset = out.size();
+				const size_t errors_offset = _errors.size();
+				const unsigned short recursion_count = _recursion_count;
+				const unsigned int line = _token.location.line;
+				const bool at_line_begin = _token.location.column <= 1;
+
+				push(arguments[index] + static_cast<char>(macro_replacement_argument));
+				while (true)
+				{
+					// Consume all tokens here, so spaces are added to the output too
+					consume();
+					if (_token == tokenid::unknown) // 'macro_replacement_argument' is 'tokenid::unknown'
+						break;
+					if (_token == tokenid::identifier && evaluate_identifier_as_macro())
+						continue;
+					out += _current_token_raw_data;
+				}
+				assert(_current_token_raw_data[0] == macro_replacement_argument);
+
+				// Locations are only derived from the start location when the argument fits on a single line, and any errors or warnings would have to be reported again
+				if (_errors.size() == errors_offset && arguments[index].find('\n') == std::string::npos)
+				{
+					expanded.valid = true;
+					expanded.text = out.substr(out_offset);
+					expanded.recursion_count = _recursion_count - recursion_count;
+					expanded.line = line;
+					expanded.at_line_begin = at_line_begin;
+				}
 			}
-			assert(_current_token_raw_data[0] == macro_replacement_argument);
 			break;
 		}
 	}
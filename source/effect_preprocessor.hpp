@@ -6,7 +6,7 @@
 #pragma once
 
 #include "effect_token.hpp"
-#include <memory> // std::unique_ptr
+#include <memory> // std::unique_ptr, std::shared_ptr
 #include <filesystem>
 #include <unordered_set>
 #include <unordered_map>
@@ -89,6 +89,11 @@ namespace reshadefx
 		/// </summary>
 		/// <returns></returns>
 		std::vector<std::pair<std::string, std::string>> used_macro_definitions() const;
+		/// <summary>
+		/// Get a list of all defined macros that were referenced during preprocessing (either expanded or checked for with #ifdef, #ifndef or defined()).
+		/// This can be used to figure out which of the macro definitions added before the output actually depends on.
+		/// </summary>
+		std::vector<std::string> referenced_macros() const;
 
 	private:
 		struct if_level
@@ -98,18 +103,29 @@ namespace reshadefx
 			token pp_token;
 			size_t input_index;
 		};
+		/// <summary>
+		/// Node in the list of macros that may not be expanded again while reading an input level (because that level is the result of expanding them).
+		/// Levels share the nodes of the level they were pushed on top of, instead of copying the whole set.
+		/// </summary>
+		struct hidden_macro
+		{
+			std::string name;
+			std::shared_ptr<const hidden_macro> parent;
+		};
 		struct input_level
 		{
 			std::string name;
 			std::unique_ptr<class lexer> lexer;
 			token next_token;
-			std::unordered_set<std::string> hidden_macros;
+			std::shared_ptr<const hidden_macro> hidden_macros;
 		};
+		struct include_recording;
 
 		void error(const location &location, const std::string &message);
 		void warning(const location &location, const std::string &message);
 
 		void push(std::string input, const std::string &name = std::string());
+		void push(std::shared_ptr<const std::string> input, const std::string &name);
 
 		bool peek(tokenid token) const;
 		bool consume();
@@ -137,6 +153,11 @@ namespace reshadefx
 		void expand_macro(const std::string &name, const macro &macro, const std::vector<std::string> &arguments, std::string &out);
 		void create_macro_replacement_list(macro &macro);
 
+		uint64_t compute_include_state_hash() const;
+		bool restore_include_snapshot(const std::string &file_path, const std::shared_ptr<const std::string> &file_data);
+		void begin_include_recording(const std::string &file_path, const std::shared_ptr<const std::string> &file_data);
+		void end_include_recording(bool store_snapshot);
+
 		bool _success = true;
 		std::string _output, _errors;
 		std::string _current_token_raw_data;
@@ -148,8 +169,10 @@ namespace reshadefx
 		unsigned short _recursion_count = 0;
 		location _output_location;
 		std::unordered_set<std::string> _used_macros;
+		std::unordered_set<std::string> _referenced_macros;
 		std::unordered_map<std::string, macro> _macros;
 		std::vector<std::filesystem::path> _include_paths;
-		std::unordered_map<std::string, std::string> _file_cache;
+		std::unordered_map<std::string, std::shared_ptr<const std::string>> _file_cache;
+		std::unique_ptr<include_recording> _include_recording;
 	};
 }
@@ -5,6 +5,7 @@
 
 #include "effect_symbol_table.hpp"
 #include <cassert>
+#include <cstring> // std::memcpy
 #include <malloc.h> // alloca
 #include <algorithm> // std::upper_bound, std::sort
 
@@ -114,6 +115,14 @@ static const intrinsic s_intrinsics[] =
 #undef sampler
 #undef storage
 
+// Group intrinsic overloads by name once at startup, so that resolving a call only has to compare against the overloads of that name instead of all intrinsics
+static const std::unordered_map<std::string_view, std::vector<const intrinsic *>> s_intrinsic_overloads = []() {
+	std::unordered_map<std::string_view, std::vector<const intrinsic *>> overloads;
+	for (const intrinsic &intrinsic : s_intrinsics)
+		overloads[intrinsic.function.name].push_back(&intrinsic); // Keeps declaration order within each overload set
+	return overloads;
+}();
+
 #pragma endregion
 
 unsigned int reshadefx::type::rank(const type &src, const type &dst)
@@ -177,9 +186,11 @@ void reshadefx::symbol_table::leave_scope()
 {
 	assert(_current_scope.level > 0);
 
-	for (auto &symbol : _symbol_stack)
+	// Only names that were declared in this scope (or a nested one) can have symbols that need to be removed
+	while (!_local_names.empty() && _local_names.back().second >= _current_scope.level)
 	{
-		std::vector<scoped_symbol> &scope_list = symbol.second;
+		std::pmr::vector<scoped_symbol> &scope_list = _symbol_stack[_local_names.back().first];
+		_local_names.pop_back();
 
 		for (auto scope_it = scope_list.begin(); scope_it != scope_list.end();)
 		{
@@ -237,7 +248,7 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 			const auto previous_scope_name = _current_scope.name.substr(pos);
 
 			// Insert symbol into this scope
-			insert_sorted(_symbol_stack[previous_scope_name + name], scoped_symbol { symbol, scope });
+			insert_sorted(_symbol_stack[intern_name(previous_scope_name + name)], scoped_symbol { symbol, scope });
 
 			// Continue walking up the scope chain
 			scope.level = ++scope.namespace_level;
@@ -246,12 +257,32 @@ bool reshadefx::symbol_table::insert_symbol(const std::string &name, const symbo
 	else
 	{
 		// This is a local symbol so it's sufficient to update the symbol stack with just the current scope
-		insert_sorted(_symbol_stack[name], scoped_symbol { symbol, _current_scope });
+		const uint32_t name_index = intern_name(name);
+		insert_sorted(_symbol_stack[name_index], scoped_symbol { symbol, _current_scope });
+
+		if (_current_scope.level > _current_scope.namespace_level)
+			_local_names.emplace_back(name_index, _current_scope.level);
 	}
 
 	return true;
 }
 
+uint32_t reshadefx::symbol_table::intern_name(const std::string &name)
+{
+	if (const auto it = _names.find(name); it != _names.end())
+		return it->second;
+
+	// Copy name into the arena, so that the lookup table key stays valid for the lifetime of the symbol table
+	const auto name_data = static_cast<char *>(_arena.allocate(name.size(), alignof(char)));
+	std::memcpy(name_data, name.data(), name.size());
+
+	const auto name_index = static_cast<uint32_t>(_symbol_stack.size());
+	_names.emplace(std::string_view(name_data, name.size()), name_index);
+	_symbol_stack.emplace_back();
+
+	return name_index;
+}
+
 reshadefx::scoped_symbol reshadefx::symbol_table::find_symbol(const std::string &name) const
 {
 	// Default to start search with current scope and walk back the scope chain
@@ -259,16 +290,18 @@ reshadefx::scoped_symbol reshadefx::symbol_table::find_symbol(const std::string
 }
 reshadefx::scoped_symbol reshadefx::symbol_table::find_symbol(const std::string &name, const scope &scope, bool exclusive) const
 {
-	const auto stack_it = _symbol_stack.find(name);
+	const auto name_it = _names.find(name);
 
 	// Check if symbol does exist
-	if (stack_it == _symbol_stack.end() || stack_it->second.empty())
+	if (name_it == _names.end() || _symbol_stack[name_it->second].empty())
 		return {};
 
+	const std::pmr::vector<scoped_symbol> &scope_list = _symbol_stack[name_it->second];
+
 	// Walk up the scope chain starting at the requested scope level and find a matching symbol
 	scoped_symbol result = {};
 
-	for (auto it = stack_it->second.rbegin(), end = stack_it->second.rend(); it != end; ++it)
+	for (auto it = scope_list.rbegin(), end = scope_list.rend(); it != end; ++it)
 	{
 		if (it->scope.level > scope.level ||
 			it->scope.namespace_level > scope.namespace_level || (it->scope.namespace_level == scope.namespace_level && it->scope.name != scope.name))
@@ -343,11 +376,11 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	unsigned int overload_namespace = scope.namespace_level;
 
 	// Look up function name in the symbol stack and loop through the associated symbols
-	const auto stack_it = _symbol_stack.find(name);
-
-	if (stack_it != _symbol_stack.end() && !stack_it->second.empty())
+	if (const auto name_it = _names.find(name); name_it != _names.end())
 	{
-		for (auto it = stack_it->second.rbegin(), end = stack_it->second.rend(); it != end; ++it)
+		const std::pmr::vector<scoped_symbol> &scope_list = _symbol_stack[name_it->second];
+
+		for (auto it = scope_list.rbegin(), end = scope_list.rend(); it != end; ++it)
 		{
 			if (it->op != symbol_type::function)
 				continue;
@@ -401,26 +434,31 @@ bool reshadefx::symbol_table::resolve_function_call(const std::string &name, con
 	// Try matching against intrinsic functions if no matching user-defined function was found up to this point
 	if (num_overloads == 0)
 	{
-		for (const intrinsic &intrinsic : s_intrinsics)
+		const auto overloads_it = s_intrinsic_overloads.find(name);
+
+		if (overloads_it != s_intrinsic_overloads.end())
 		{
-			if (intrinsic.function.name != name || intrinsic.function.parameter_list.size() != arguments.size())
-				continue;
+			for (const intrinsic *const overload : overloads_it->second)
+			{
+				if (overload->function.parameter_list.size() != arguments.size())
+					continue;
 
-			// A new possibly-matching intrinsic function was found, compare it against the current result
-			const int comparison = compare_functions(arguments, &intrinsic.function, result);
+				// A new possibly-matching intrinsic function was found, compare it against the current result
+				const int comparison = compare_functions(arguments, &overload->function, result);
 
-			if (comparison < 0) // The new function is a better match
-			{
-				out_data.op = symbol_type::intrinsic;
-				out_data.id = intrinsic.id;
-				out_data.type = intrinsic.function.return_type;
-				out_data.function = &intrinsic.function;
-				result = out_data.function;
-				num_overloads = 1;
-			}
-			else if (comparison == 0 && overload_namespace == 0) // Both functions are equally viable, so the call is ambiguous (intrinsics are always in the global namespace)
-			{
-				++num_overloads;
+				if (comparison < 0) // The new function is a better match
+				{
+					out_data.op = symbol_type::intrinsic;
+					out_data.id = overload->id;
+					out_data.type = overload->function.return_type;
+					out_data.function = &overload->function;
+					result = out_data.function;
+					num_overloads = 1;
+				}
+				else if (comparison == 0 && overload_namespace == 0) // Both functions are equally viable, so the call is ambiguous (intrinsics are always in the global namespace)
+				{
+					++num_overloads;
+				}
 			}
 		}
 	}
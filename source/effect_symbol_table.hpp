@@ -6,7 +6,9 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include <string_view>
 #include <unordered_map> // Used for symbol lookup table
+#include <memory_resource>
 
 namespace reshadefx
 {
@@ -96,8 +98,20 @@ namespace reshadefx
 		bool resolve_function_call(const std::string &name, const std::vector<expression> &args, const scope &scope, symbol &data, bool &ambiguous) const;
 
 	private:
+		/// <summary>
+		/// Returns the index of the specified <paramref name="name"/> in the symbol stack, adding a new entry for it if it was not seen before.
+		/// </summary>
+		uint32_t intern_name(const std::string &name);
+
+		// The symbol stack constantly grows and shrinks while parsing, so serve it from an arena that is freed all at once with the parser
+		std::pmr::monotonic_buffer_resource _arena_buffer;
+		std::pmr::unsynchronized_pool_resource _arena { &_arena_buffer };
+
 		scope _current_scope;
-		std::unordered_map<std::string, // Lookup table from name to matching symbols
-			std::vector<scoped_symbol>> _symbol_stack;
+		// Every name is only stored once and then referred to by its index, which avoids hashing it again on every access of its symbols
+		std::pmr::unordered_map<std::string_view, uint32_t> _names { &_arena };
+		std::pmr::vector<std::pmr::vector<scoped_symbol>> _symbol_stack { &_arena };
+		// Names that have symbols in a local scope, which are removed again when that scope is left (sorted by scope level)
+		std::pmr::vector<std::pair<uint32_t, unsigned int>> _local_names { &_arena };
 	};
 }
@@ -5,16 +5,22 @@
 
 #pragma once
 
+#include <mutex>
 #include <atomic>
+#include <thread>
 #include <utility>
 #include <cassert>
+#include <cstdint>
 
 /// <summary>
-/// A simple lock-free linear search table.
+/// A growable hash table with lock-free look ups.
+/// Entries are stored with open addressing and linear probing, erased entries leave a tombstone that is reused by later insertions.
+/// Adding and removing entries is serialized, but never blocks threads looking up values, not even while the table is resized.
 /// The key values "one" and "zero" hold a special meaning (see <see cref="no_value"/> and <see cref="update_value"/>), so do not use them.
 /// </summary>
-template <typename TKey, typename TValue, size_t MAX_ENTRIES>
-class lockfree_table : lockfree_table<TKey, TValue *, MAX_ENTRIES>
+/// <typeparam name="INITIAL_SIZE">The number of entries to allocate initially (must be a power of two).</typeparam>
+template <typename TKey, typename TValue, size_t INITIAL_SIZE>
+class lockfree_table : lockfree_table<TKey, TValue *, INITIAL_SIZE>
 {
 public:
 	~lockfree_table()
@@ -22,8 +28,8 @@ public:
 		clear(); // Free all pointers
 	}
 
-	using lockfree_table<TKey, TValue *, MAX_ENTRIES>::no_value;
-	using lockfree_table<TKey, TValue *, MAX_ENTRIES>::update_value;
+	using lockfree_table<TKey, TValue *, INITIAL_SIZE>::no_value;
+	using lockfree_table<TKey, TValue *, INITIAL_SIZE>::update_value;
 
 	/// <summary>
 	/// Gets the value associated with the specified <paramref name="key"/>.
@@ -33,7 +39,7 @@ public:
 	/// <returns>A reference to the associated value.</returns>
 	TValue &at(TKey key) const
 	{
-		TValue *const value = lockfree_table<TKey, TValue *, MAX_ENTRIES>::at(key);
+		TValue *const value = lockfree_table<TKey, TValue *, INITIAL_SIZE>::at(key);
 		if (value != nullptr)
 			return *value;
 
@@ -52,12 +58,12 @@ public:
 	{
 		// Create a pointer to the new value using copy construction
 		TValue *const new_value = new TValue(std::forward<Args>(args)...);
-		if (lockfree_table<TKey, TValue *, MAX_ENTRIES>::emplace(key, new_value))
+		if (lockfree_table<TKey, TValue *, INITIAL_SIZE>::emplace(key, new_value))
 			return *new_value;
 		delete new_value;
 
 		assert(false);
-		return default_value(); // Fall back if table is full
+		return default_value(); // Fall back if key already exists
 	}
 
 	/// <summary>
@@ -67,7 +73,7 @@ public:
 	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
 	bool erase(TKey key)
 	{
-		TValue *const old_value = lockfree_table<TKey, TValue *, MAX_ENTRIES>::erase(key);
+		TValue *const old_value = lockfree_table<TKey, TValue *, INITIAL_SIZE>::erase(key);
 		if (old_value != nullptr)
 		{
 			delete old_value;
@@ -83,7 +89,7 @@ public:
 	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
 	bool erase(TKey key, TValue &value)
 	{
-		TValue *const old_value = lockfree_table<TKey, TValue *, MAX_ENTRIES>::erase(key);
+		TValue *const old_value = lockfree_table<TKey, TValue *, INITIAL_SIZE>::erase(key);
 		if (old_value != nullptr)
 		{
 			// Move value to output argument and delete its pointer (which is no longer in use now)
@@ -95,23 +101,12 @@ public:
 	}
 
 	/// <summary>
-	/// Clears the entire table and deletes all keys.
+	/// Clears the entire table and deletes all values.
 	/// Note that another thread may add new values while this operation is in progress, so do not rely on it.
 	/// </summary>
 	void clear()
 	{
-		for (size_t i = 0; i < MAX_ENTRIES; ++i)
-		{
-			TValue *const old_value = _data[i].second;
-
-			// Clear this entry so it can be used again
-			if (TKey current_key = _data[i].first.exchange(no_value);
-				current_key != no_value && current_key != update_value) // If this in update mode, we can assume the thread updating will reset the key to its intended value
-			{
-				// Delete any value attached to the entry, but only if there was one to begin with
-				delete old_value;
-			}
-		}
+		lockfree_table<TKey, TValue *, INITIAL_SIZE>::clear([](TValue *old_value) { delete old_value; });
 	}
 
 private:
@@ -125,15 +120,18 @@ private:
 /// <summary>
 /// Overload of the lock-free table for pointer value types, which avoids an extra indirection and stores the pointers directly.
 /// </summary>
-template <typename TKey, typename TValue, size_t MAX_ENTRIES>
-class lockfree_table<TKey, TValue *, MAX_ENTRIES>
+template <typename TKey, typename TValue, size_t INITIAL_SIZE>
+class lockfree_table<TKey, TValue *, INITIAL_SIZE>
 {
+	static_assert(INITIAL_SIZE >= 4 && (INITIAL_SIZE & (INITIAL_SIZE - 1)) == 0, "initial size has to be a power of two");
+
 	using TValuePtr = TValue * ;
 
 public:
+	lockfree_table() : _table(new table(INITIAL_SIZE)) {}
 	~lockfree_table()
 	{
-		clear();
+		delete _table.load(std::memory_order_relaxed);
 	}
 
 	/// <summary>
@@ -141,7 +139,7 @@ public:
 	/// </summary>
 	static constexpr TKey no_value = (TKey)0;
 	/// <summary>
-	/// Special key indicating that the entry is currently being updated.
+	/// Special key indicating that the entry was erased (and can be reused).
 	/// </summary>
 	static constexpr TKey update_value = (TKey)1;
 
@@ -155,18 +153,25 @@ public:
 	{
 		assert(key != no_value && key != update_value);
 
-		// If the table is really big, reduce search time by using hash as start index
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+		const read_guard guard(*this);
+
+		const table *const t = _table.load(std::memory_order_seq_cst);
 
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (size_t i = hash(key) & t->mask, n = 0; n <= t->mask; i = (i + 1) & t->mask, ++n)
 		{
-			if (_data[i].first.load(std::memory_order_acquire) == key)
+			const TKey test_key = t->entries[i].key.load(std::memory_order_acquire);
+			if (test_key == key)
 			{
-				// The pointer is guaranteed to be value at this point, or else key would have been in update mode
-				return _data[i].second;
+				const TValuePtr value = t->entries[i].value.load(std::memory_order_acquire);
+
+				// The entry may have been erased and reused for another key while reading the value, so check that the key is still the same
+				if (t->entries[i].key.load(std::memory_order_acquire) != key)
+					break;
+
+				return value;
 			}
+			if (test_key == no_value)
+				break; // Reached the end of the probe sequence
 		}
 
 		return nullptr;
@@ -177,30 +182,52 @@ public:
 	/// </summary>
 	/// <param name="key">The key to add.</param>
 	/// <param name="value">The pointer to add.</param>
-	/// <returns>The <c>true</c> if the key-pointer pair was added successfully or <c>false</c> if the table is full.</returns>
+	/// <returns>The <c>true</c> if the key-pointer pair was added successfully or <c>false</c> if the key already exists.</returns>
 	bool emplace(TKey key, TValuePtr value)
 	{
 		assert(key != no_value && key != update_value);
 
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+		const std::lock_guard<std::mutex> lock(_write_mutex);
 
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
-		{
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == no_value &&
-				_data[i].first.compare_exchange_strong(test_key, update_value, std::memory_order_relaxed))
-			{
-				_data[i].second = value;
+		table *t = _table.load(std::memory_order_relaxed);
+
+		// Keep at least a quarter of all entries empty, so that probe sequences stay short
+		if ((t->num_used + 1) * 4 > t->capacity() * 3)
+			t = resize(t);
 
-				_data[i].first.store(key, std::memory_order_release);
+		entry *free_entry = nullptr;
 
-				return true;
+		for (size_t i = hash(key) & t->mask, n = 0; n <= t->mask; i = (i + 1) & t->mask, ++n)
+		{
+			const TKey test_key = t->entries[i].key.load(std::memory_order_relaxed);
+			if (test_key == key)
+				return false;
+
+			if (test_key == update_value)
+			{
+				// Reuse the first tombstone in the probe sequence, but keep searching in case the key already exists further on
+				if (free_entry == nullptr)
+					free_entry = &t->entries[i];
+			}
+			else if (test_key == no_value)
+			{
+				if (free_entry == nullptr)
+				{
+					free_entry = &t->entries[i];
+					t->num_used++;
+				}
+				break;
 			}
 		}
 
-		return false;
+		assert(free_entry != nullptr);
+
+		// Value has to be visible before the key is, since readers only check the key before reading the value
+		free_entry->value.store(value, std::memory_order_relaxed);
+		free_entry->key.store(key, std::memory_order_release);
+		t->num_live++;
+
+		return true;
 	}
 
 	/// <summary>
@@ -213,24 +240,34 @@ public:
 		if (key == no_value || key == update_value) // Cannot remove special keys
 			return nullptr;
 
-		size_t start_index = 0;
-		if constexpr (MAX_ENTRIES > 512)
-			start_index = std::hash<TKey>()(key) % (MAX_ENTRIES / 2);
+		const std::lock_guard<std::mutex> lock(_write_mutex);
+
+		table *const t = _table.load(std::memory_order_relaxed);
 
-		for (size_t i = start_index; i < MAX_ENTRIES; ++i)
+		for (size_t i = hash(key) & t->mask, n = 0; n <= t->mask; i = (i + 1) & t->mask, ++n)
 		{
-			// Load and check before doing an expensive CAS
-			if (TKey test_key = _data[i].first.load(std::memory_order_relaxed);
-				test_key == key)
+			const TKey test_key = t->entries[i].key.load(std::memory_order_relaxed);
+			if (test_key == key)
 			{
-				// Get the value before freeing the entry up for other threads to fill again
-				const TValuePtr old_value = _data[i].second;
+				const TValuePtr old_value = t->entries[i].value.load(std::memory_order_relaxed);
 
-				if (_data[i].first.compare_exchange_strong(test_key, no_value, std::memory_order_relaxed))
+				t->entries[i].key.store(update_value, std::memory_order_release);
+				t->num_live--;
+
+				// Tombstones directly followed by an empty entry do not continue any probe sequence, so can be made empty again
+				if (t->entries[(i + 1) & t->mask].key.load(std::memory_order_relaxed) == no_value)
 				{
-					return old_value;
+					for (size_t k = i; t->entries[k].key.load(std::memory_order_relaxed) == update_value; k = (k - 1) & t->mask)
+					{
+						t->entries[k].key.store(no_value, std::memory_order_release);
+						t->num_used--;
+					}
 				}
+
+				return old_value;
 			}
+			if (test_key == no_value)
+				break;
 		}
 
 		return nullptr;
@@ -241,12 +278,146 @@ public:
 	/// </summary>
 	void clear()
 	{
-		for (size_t i = 0; i < MAX_ENTRIES; ++i)
+		clear([](TValuePtr) {});
+	}
+
+protected:
+	/// <summary>
+	/// Clears the entire table and calls the specified <paramref name="callback"/> with the pointer of every entry that was removed.
+	/// </summary>
+	template <typename F>
+	void clear(F callback)
+	{
+		const std::lock_guard<std::mutex> lock(_write_mutex);
+
+		table *const t = _table.load(std::memory_order_relaxed);
+
+		for (size_t i = 0; i <= t->mask; ++i)
 		{
-			_data[i].first.exchange(no_value);
+			if (const TKey old_key = t->entries[i].key.exchange(no_value, std::memory_order_acq_rel);
+				old_key != no_value && old_key != update_value)
+				callback(t->entries[i].value.load(std::memory_order_relaxed));
 		}
+
+		t->num_used = 0;
+		t->num_live = 0;
 	}
 
-protected:
-	std::pair<std::atomic<TKey>, TValuePtr> _data[MAX_ENTRIES];
+private:
+	struct entry
+	{
+		std::atomic<TKey> key = no_value;
+		std::atomic<TValuePtr> value = nullptr;
+	};
+
+	struct table
+	{
+		explicit table(size_t capacity) : mask(capacity - 1), entries(new entry[capacity]) {}
+		~table() { delete[] entries; }
+
+		size_t capacity() const { return mask + 1; }
+
+		const size_t mask;
+		entry *const entries;
+		size_t num_used = 0; // Number of entries that are not empty (including tombstones)
+		size_t num_live = 0;
+	};
+
+	/// <summary>
+	/// Registers a thread looking up a value for the lifetime of this object, so that the table it reads from is not freed by a concurrent resize.
+	/// Readers are counted on one of several cache lines (chosen per thread) to avoid contention between threads.
+	/// </summary>
+	class read_guard
+	{
+	public:
+		explicit read_guard(const lockfree_table &parent) :
+			_counter(parent._readers[thread_slot()].count[parent._epoch.load(std::memory_order_seq_cst) & 1])
+		{
+			_counter.fetch_add(1, std::memory_order_seq_cst);
+		}
+		~read_guard()
+		{
+			_counter.fetch_sub(1, std::memory_order_release);
+		}
+
+	private:
+		std::atomic<uint32_t> &_counter;
+	};
+
+	static constexpr size_t NUM_READER_SLOTS = 8;
+
+	struct alignas(64) reader_slot
+	{
+		std::atomic<uint32_t> count[2] = {};
+	};
+
+	static size_t thread_slot()
+	{
+		static std::atomic<size_t> s_next_slot = 0;
+		static thread_local const size_t slot = s_next_slot.fetch_add(1, std::memory_order_relaxed) % NUM_READER_SLOTS;
+		return slot;
+	}
+
+	static size_t hash(TKey key)
+	{
+		// Handles and pointers are usually aligned and allocated in sequence, so mix all bits to get an even distribution
+		uint64_t h = (uint64_t)key;
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		return static_cast<size_t>(h);
+	}
+
+	/// <summary>
+	/// Replaces the table with a new one that only contains the live entries of the old table.
+	/// The new table is twice as large if that is required to fit them, otherwise this only gets rid of tombstones.
+	/// </summary>
+	table *resize(table *old_table)
+	{
+		size_t capacity = old_table->capacity();
+		while ((old_table->num_live + 1) * 2 > capacity)
+			capacity *= 2;
+
+		table *const new_table = new table(capacity);
+
+		for (size_t i = 0; i <= old_table->mask; ++i)
+		{
+			const TKey key = old_table->entries[i].key.load(std::memory_order_relaxed);
+			if (key == no_value || key == update_value)
+				continue;
+
+			size_t k = hash(key) & new_table->mask;
+			while (new_table->entries[k].key.load(std::memory_order_relaxed) != no_value)
+				k = (k + 1) & new_table->mask;
+
+			new_table->entries[k].key.store(key, std::memory_order_relaxed);
+			new_table->entries[k].value.store(old_table->entries[i].value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		new_table->num_used = old_table->num_live;
+		new_table->num_live = old_table->num_live;
+
+		_table.store(new_table, std::memory_order_seq_cst);
+
+		// Wait for all readers that may still be using the old table to finish before freeing it
+		// Readers that start after switching the epoch count on the other counter, so the counters of the previous epoch are guaranteed to drop to zero
+		// Doing this twice ensures readers that read the epoch before the first switch, but only incremented the counter after it was checked, are covered too
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			const uint32_t previous_epoch = _epoch.fetch_add(1, std::memory_order_seq_cst) & 1;
+
+			for (const reader_slot &readers : _readers)
+				while (readers.count[previous_epoch].load(std::memory_order_seq_cst) != 0)
+					std::this_thread::yield();
+		}
+
+		delete old_table;
+
+		return new_table;
+	}
+
+	std::atomic<table *> _table;
+	std::mutex _write_mutex;
+	std::atomic<uint32_t> _epoch = 0;
+	mutable reader_slot _readers[NUM_READER_SLOTS];
 };
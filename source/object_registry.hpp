@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include "lockfree_table.hpp"
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+/// <summary>
+/// A registry of data associated with native API object handles, for use by the device implementations of the render APIs.
+/// The data is stored in slabs of fixed size, which are never moved or freed before the registry is destroyed, so every object keeps a stable index for its entire lifetime and looking it up never has to wait on other threads.
+/// New slabs are allocated on demand, so there is no limit on the number of objects.
+/// Each slot has a generation counter that is incremented whenever an object is added to or removed from it, so that references to an object whose slot was reused since can be detected.
+/// </summary>
+/// <typeparam name="SLAB_SIZE">The number of objects per slab (must be a power of two).</typeparam>
+template <typename TKey, typename TValue, size_t SLAB_SIZE = 256>
+class object_registry
+{
+	static_assert(SLAB_SIZE != 0 && (SLAB_SIZE & (SLAB_SIZE - 1)) == 0, "slab size has to be a power of two");
+
+	struct slot
+	{
+		// Odd while the slot is occupied and even while it is free
+		std::atomic<uint32_t> generation = 0;
+		std::atomic<TKey> key = TKey();
+		uint32_t index = 0;
+		TValue value = {};
+	};
+
+public:
+	/// <summary>
+	/// A reference to an object in the registry, which stays valid until that object is removed again.
+	/// </summary>
+	struct handle
+	{
+		uint32_t index;
+		uint32_t generation;
+
+		/// <summary>
+		/// Checks whether this handle referenced an object at the time it was retrieved (it may have been removed since, see <see cref="object_registry::get"/>).
+		/// </summary>
+		explicit operator bool() const { return generation != 0; }
+	};
+
+	object_registry()
+	{
+		_directories.push_back(std::make_unique<slab_directory>(INITIAL_SLABS));
+		_directory.store(_directories.back().get(), std::memory_order_relaxed);
+	}
+	object_registry(const object_registry &) = delete;
+	~object_registry()
+	{
+		// The latest directory references all slabs ever allocated
+		const slab_directory *const directory = _directory.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < directory->capacity; ++i)
+			delete[] directory->slabs[i].load(std::memory_order_relaxed);
+	}
+
+	object_registry &operator=(const object_registry &) = delete;
+
+	/// <summary>
+	/// Gets a handle to the object associated with the specified <paramref name="key"/>.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns>A handle to the object, or a handle that evaluates to <c>false</c> if the key does not exist.</returns>
+	handle find(TKey key) const
+	{
+		if (const slot *const s = _lookup.at(key); s != nullptr)
+		{
+			const uint32_t generation = s->generation.load(std::memory_order_acquire);
+			if ((generation & 1) != 0 && s->key.load(std::memory_order_relaxed) == key)
+				return { s->index, generation };
+		}
+		return { 0, 0 };
+	}
+
+	/// <summary>
+	/// Gets the object referenced by the specified <paramref name="handle"/>.
+	/// This only consists of indexing into the slab the object is stored in, so is wait-free.
+	/// </summary>
+	/// <param name="handle">The handle to look up.</param>
+	/// <returns>A pointer to the object, or <c>nullptr</c> if it was removed from the registry since the handle was retrieved.</returns>
+	TValue *get(handle handle) const
+	{
+		if (handle.generation == 0)
+			return nullptr;
+
+		slot *const s = slot_at(handle.index);
+		if (s == nullptr || s->generation.load(std::memory_order_acquire) != handle.generation)
+			return nullptr;
+
+		return &s->value;
+	}
+
+	/// <summary>
+	/// Gets the object associated with the specified <paramref name="key"/>.
+	/// This is a weak look up and may return stale data if another thread is removing the object at the same time.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns>A reference to the associated object.</returns>
+	TValue &at(TKey key) const
+	{
+		if (slot *const s = _lookup.at(key); s != nullptr)
+			return s->value;
+
+		assert(false);
+		return default_value(); // Fall back if key does not exist
+	}
+
+	/// <summary>
+	/// Copies the object associated with the specified <paramref name="key"/>.
+	/// In contrast to <see cref="at"/> this checks that the object was not removed or replaced while it was copied, so the result is always consistent.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <param name="value">The object associated with that key.</param>
+	/// <returns><c>true</c> if the key exists, <c>false</c> otherwise.</returns>
+	bool try_get(TKey key, TValue &value) const
+	{
+		static_assert(std::is_trivially_copyable_v<TValue>, "consistent copies are only supported for trivially copyable types");
+
+		const slot *const s = _lookup.at(key);
+		if (s == nullptr)
+			return false;
+
+		const uint32_t generation = s->generation.load(std::memory_order_acquire);
+		if ((generation & 1) == 0 || s->key.load(std::memory_order_relaxed) != key)
+			return false;
+
+		value = s->value;
+
+		// Slot may have been reused while copying, in which case the generation changed
+		std::atomic_thread_fence(std::memory_order_acquire);
+		return s->generation.load(std::memory_order_relaxed) == generation;
+	}
+
+	/// <summary>
+	/// Adds an object associated with the specified <paramref name="key"/> to the registry.
+	/// If the key already exists, its object is replaced (e.g. because the native API reused the handle), which invalidates all handles to it.
+	/// </summary>
+	/// <param name="key">The key to add.</param>
+	/// <param name="args">The constructor arguments to use for creation.</param>
+	/// <returns>A reference to the newly added object.</returns>
+	template <typename... Args>
+	TValue &emplace(TKey key, Args &&... args)
+	{
+		const std::lock_guard<std::mutex> lock(_write_mutex);
+
+		slot *s = _lookup.at(key);
+		if (s != nullptr)
+		{
+			// Replace object in place, but go through a free generation, so that concurrent readers notice
+			s->generation.fetch_add(1, std::memory_order_acq_rel);
+			s->value = TValue(std::forward<Args>(args)...);
+			s->generation.fetch_add(1, std::memory_order_release);
+			return s->value;
+		}
+
+		s = allocate_slot();
+
+		s->value = TValue(std::forward<Args>(args)...);
+		s->key.store(key, std::memory_order_relaxed);
+		s->generation.fetch_add(1, std::memory_order_release);
+
+		_lookup.emplace(key, s);
+
+		return s->value;
+	}
+
+	/// <summary>
+	/// Removes the object associated with the specified <paramref name="key"/> from the registry.
+	/// </summary>
+	/// <param name="key">The key to look up.</param>
+	/// <returns><c>true</c> if the key existed and was removed, <c>false</c> otherwise.</returns>
+	bool erase(TKey key)
+	{
+		const std::lock_guard<std::mutex> lock(_write_mutex);
+
+		slot *const s = _lookup.erase(key);
+		if (s == nullptr)
+			return false;
+
+		free_slot(s);
+		return true;
+	}
+
+	/// <summary>
+	/// Removes all objects from the registry.
+	/// The slabs are kept allocated, so that they can be reused by objects added later.
+	/// </summary>
+	void clear()
+	{
+		const std::lock_guard<std::mutex> lock(_write_mutex);
+
+		_lookup.clear();
+
+		for (uint32_t index = 0; index < _num_slots; ++index)
+			if (slot *const s = slot_at(index); (s->generation.load(std::memory_order_relaxed) & 1) != 0)
+				free_slot(s);
+	}
+
+private:
+	static constexpr size_t INITIAL_SLABS = 16;
+
+	/// <summary>
+	/// Array of pointers to all slabs, which is replaced by a larger copy when it runs out of space.
+	/// </summary>
+	struct slab_directory
+	{
+		explicit slab_directory(size_t capacity) : capacity(capacity), slabs(new std::atomic<slot *>[capacity]()) {}
+
+		const size_t capacity;
+		const std::unique_ptr<std::atomic<slot *>[]> slabs;
+	};
+
+	slot *slot_at(uint32_t index) const
+	{
+		const slab_directory *const directory = _directory.load(std::memory_order_acquire);
+		if (index / SLAB_SIZE >= directory->capacity)
+			return nullptr;
+
+		slot *const slab = directory->slabs[index / SLAB_SIZE].load(std::memory_order_acquire);
+		return slab != nullptr ? &slab[index % SLAB_SIZE] : nullptr;
+	}
+
+	slot *allocate_slot()
+	{
+		if (!_free_indices.empty())
+		{
+			const uint32_t index = _free_indices.back();
+			_free_indices.pop_back();
+			return slot_at(index);
+		}
+
+		const uint32_t index = _num_slots;
+
+		// Allocate a new slab when the previous one is full
+		if (index % SLAB_SIZE == 0)
+		{
+			slab_directory *directory = _directory.load(std::memory_order_relaxed);
+			if (index / SLAB_SIZE >= directory->capacity)
+			{
+				// Readers may still be looking at the old directory, so it is only freed together with the registry (all directories together take up at most twice the space of the latest one)
+				_directories.push_back(std::make_unique<slab_directory>(directory->capacity * 2));
+				slab_directory *const new_directory = _directories.back().get();
+				for (size_t i = 0; i < directory->capacity; ++i)
+					new_directory->slabs[i].store(directory->slabs[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+				_directory.store(new_directory, std::memory_order_release);
+				directory = new_directory;
+			}
+
+			slot *const slab = new slot[SLAB_SIZE];
+			for (uint32_t i = 0; i < SLAB_SIZE; ++i)
+				slab[i].index = index + i;
+			directory->slabs[index / SLAB_SIZE].store(slab, std::memory_order_release);
+		}
+
+		_num_slots = index + 1;
+		return slot_at(index);
+	}
+	void free_slot(slot *s)
+	{
+		s->generation.fetch_add(1, std::memory_order_release);
+
+		// Release any memory the object holds on to right away, rather than only when the slot is reused
+		if constexpr (!std::is_trivially_destructible_v<TValue>)
+			s->value = TValue();
+
+		_free_indices.push_back(s->index);
+	}
+
+	static inline TValue &default_value()
+	{
+		// Make default value thread local, so no data races occur after multiple threads failed to access a value
+		static thread_local TValue _ = {}; return _;
+	}
+
+	std::mutex _write_mutex;
+	lockfree_table<TKey, slot *, 4096> _lookup;
+	std::atomic<slab_directory *> _directory;
+	std::vector<std::unique_ptr<slab_directory>> _directories;
+	uint32_t _num_slots = 0;
+	std::vector<uint32_t> _free_indices;
+};
@@ -841,7 +841,7 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_buffer_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
 		GLint src_object = 0;
 		glGetIntegerv(reshade::opengl::get_binding_for_target(readTarget), &src_object);
@@ -862,7 +862,7 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyImageSubData(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ, GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ, GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		const int32_t src_box[6] = { srcX, srcY, srcZ, srcX + srcWidth, srcY + srcHeight, srcZ + srcDepth };
 		const int32_t dst_box[6] = { dstX, dstY, dstZ, dstX + srcWidth, dstY + srcHeight, dstZ + srcDepth };
@@ -882,7 +882,7 @@ HOOK_EXPORT void WINAPI glColorPointer(GLint size, GLenum type, GLsizei stride,
 			void WINAPI glCopyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_buffer_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_buffer_region>())
 	{
 		if (reshade::invoke_addon_event<reshade::addon_event::copy_buffer_region>(g_current_runtime,
 			reshade::opengl::make_resource_handle(GL_COPY_READ_BUFFER, readBuffer), readOffset,
@@ -904,7 +904,7 @@ HOOK_EXPORT void WINAPI glCopyPixels(GLint x, GLint y, GLsizei width, GLsizei he
 HOOK_EXPORT void WINAPI glCopyTexImage1D(GLenum target, GLint level, GLenum internalFormat, GLint x, GLint y, GLsizei width, GLint border)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		// TODO: Call "create_resource" event here too
@@ -928,7 +928,7 @@ HOOK_EXPORT void WINAPI glCopyTexImage1D(GLenum target, GLint level, GLenum inte
 HOOK_EXPORT void WINAPI glCopyTexImage2D(GLenum target, GLint level, GLenum internalFormat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		// TODO: Call "create_resource" event here too
@@ -952,7 +952,7 @@ HOOK_EXPORT void WINAPI glCopyTexImage2D(GLenum target, GLint level, GLenum inte
 HOOK_EXPORT void WINAPI glCopyTexSubImage1D(GLenum target, GLint level, GLint xoffset, GLint x, GLint y, GLsizei width)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		GLint dst_object = 0;
@@ -975,7 +975,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage1D(GLenum target, GLint level, GLint xo
 HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		GLint dst_object = 0;
@@ -998,7 +998,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		GLint dst_object = 0;
@@ -1021,7 +1021,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage1D(GLuint texture, GLint level, GLint xoffset, GLint x, GLint y, GLsizei width)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		const int32_t src_box[6] = { x, y, 0, x + width, y + 1, 1 };
@@ -1041,7 +1041,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage2D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		const int32_t src_box[6] = { x, y, 0, x + width, y + height, 1 };
@@ -1061,7 +1061,7 @@ HOOK_EXPORT void WINAPI glCopyTexSubImage2D(GLenum target, GLint level, GLint xo
 			void WINAPI glCopyTextureSubImage3D(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
 #if RESHADE_ADDON
-	if (g_current_runtime && !reshade::addon::event_list[static_cast<size_t>(reshade::addon_event::copy_texture_region)].empty())
+	if (g_current_runtime && reshade::has_addon_event<reshade::addon_event::copy_texture_region>())
 	{
 		// TODO: Get actual source object from current FBO and "GL_READ_BUFFER"
 		const int32_t src_box[6] = { x, y, 0, x + width, y + height, 1 };
@@ -270,6 +270,8 @@ bool reshade::opengl::device_impl::check_capability(api::device_caps capability)
 		return true;
 	case api::device_caps::copy_query_results:
 		return gl3wProcs.gl.GetQueryBufferObjectui64v != nullptr; // OpenGL 4.5
+	case api::device_caps::concurrent_pipeline_creation:
+		return false; // Objects can only be created on the thread the render context is current on
 	default:
 		return false;
 	}
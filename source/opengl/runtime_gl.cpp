@@ -247,7 +247,7 @@ bool reshade::opengl::runtime_impl::capture_screenshot(uint8_t *buffer) const
 	return true;
 }
 
-bool reshade::opengl::runtime_impl::compile_effect(effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &out)
+bool reshade::opengl::runtime_impl::compile_effect(const effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &out, std::string &, std::string &)
 {
 	if (!effect.module.spirv.empty())
 	{
@@ -9,6 +9,7 @@
 #include "addon_manager.hpp"
 #include "runtime.hpp"
 #include "runtime_objects.hpp"
+#include "task_pool.hpp"
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
@@ -74,6 +75,91 @@ static std::vector<std::filesystem::path> find_files(const std::vector<std::file
 	return files;
 }
 
+static uint64_t compute_file_hash(const std::filesystem::path &path)
+{
+	struct file_hash
+	{
+		std::filesystem::file_time_type last_write_time;
+		uintmax_t size;
+		uint64_t hash;
+	};
+
+	// Cache hashes of files that have not been modified since they were last hashed, since the same headers are included by many effects
+	static std::mutex s_file_hash_mutex;
+	static std::unordered_map<std::wstring, file_hash> s_file_hashes;
+
+	std::error_code ec;
+	const std::filesystem::file_time_type last_write_time = std::filesystem::last_write_time(path, ec);
+	const uintmax_t size = std::filesystem::file_size(path, ec);
+	if (ec)
+		return 0;
+
+	{	const std::lock_guard<std::mutex> lock(s_file_hash_mutex);
+
+		if (const auto it = s_file_hashes.find(path.native());
+			it != s_file_hashes.end() && it->second.last_write_time == last_write_time && it->second.size == size)
+			return it->second.hash;
+	}
+
+	FILE *file = nullptr;
+	if (_wfopen_s(&file, path.c_str(), L"rb") != 0)
+		return 0;
+
+	std::string data(static_cast<size_t>(size), '\0');
+	data.resize(fread(data.data(), 1, data.size(), file));
+	fclose(file);
+
+	const uint64_t hash = reshade::runtime::compute_cache_hash(data);
+
+	const std::lock_guard<std::mutex> lock(s_file_hash_mutex);
+	s_file_hashes[path.native()] = { last_write_time, size, hash };
+
+	return hash;
+}
+
+static bool check_effect_dependencies(const std::string_view dependencies, const std::vector<std::pair<std::string, std::string>> &macros)
+{
+	if (dependencies.empty())
+		return false;
+
+	for (size_t offset = 0, next; offset < dependencies.size(); offset = next + 1)
+	{
+		next = dependencies.find('\n', offset);
+		if (next == std::string_view::npos)
+			return false;
+
+		const std::string_view line = dependencies.substr(offset, next - offset);
+		const size_t value_offset = line.find(' ', 6);
+		if (value_offset == std::string_view::npos)
+			return false;
+
+		if (line.compare(0, 5, "file ") == 0)
+		{
+			const uint64_t hash = std::strtoull(line.data() + 5, nullptr, 10);
+			const std::filesystem::path path = std::filesystem::u8path(line.substr(value_offset + 1));
+
+			if (hash == 0 || compute_file_hash(path) != hash)
+				return false;
+		}
+		else if (line.compare(0, 6, "macro ") == 0)
+		{
+			const std::string_view name = line.substr(6, value_offset - 6);
+			const std::string_view value = line.substr(value_offset + 1);
+
+			if (const auto it = std::find_if(macros.begin(), macros.end(),
+				[&name](const std::pair<std::string, std::string> &macro) { return macro.first == name; });
+				it == macros.end() || it->second != value)
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
 reshade::runtime::runtime() :
 	_start_time(std::chrono::high_resolution_clock::now()),
 	_last_present_time(std::chrono::high_resolution_clock::now()),
@@ -107,7 +193,6 @@ reshade::runtime::runtime() :
 }
 reshade::runtime::~runtime()
 {
-	assert(_worker_threads.empty());
 	assert(!_is_initialized && _techniques.empty());
 
 #if RESHADE_GUI
@@ -390,15 +475,36 @@ void reshade::runtime::on_present()
 
 bool reshade::runtime::load_effect(const std::filesystem::path &source_file, const reshade::ini_file &preset, size_t effect_index, bool preprocess_required)
 {
-	std::string attributes;
-	attributes += "app=" + g_target_executable_path.stem().u8string() + ';';
-	attributes += "width=" + std::to_string(_width) + ';';
-	attributes += "height=" + std::to_string(_height) + ';';
-	attributes += "color_bit_depth=" + std::to_string(_color_bit_depth) + ';';
-	attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
-	attributes += "performance_mode=" + std::string(_performance_mode ? "1" : "0") + ';';
-	attributes += "vendor=" + std::to_string(_vendor_id) + ';';
-	attributes += "device=" + std::to_string(_device_id) + ';';
+	std::vector<std::pair<std::string, std::string>> macros = {
+		{ "__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) },
+		{ "__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0" },
+		{ "__VENDOR__", std::to_string(_vendor_id) },
+		{ "__DEVICE__", std::to_string(_device_id) },
+		{ "__RENDERER__", std::to_string(_renderer_id) },
+		{ "__APPLICATION__", std::to_string( // Truncate hash to 32-bit, since lexer currently only supports 32-bit numbers anyway
+			std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF) },
+		{ "BUFFER_WIDTH", std::to_string(_width) },
+		{ "BUFFER_HEIGHT", std::to_string(_height) },
+		{ "BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)" },
+		{ "BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)" },
+		{ "BUFFER_COLOR_BIT_DEPTH", std::to_string(_color_bit_depth) },
+	};
+
+	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
+	preprocessor_definitions.insert(preprocessor_definitions.end(), _preset_preprocessor_definitions.begin(), _preset_preprocessor_definitions.end());
+	for (const std::string &definition : preprocessor_definitions)
+	{
+		if (definition.empty() || definition == "=")
+			continue; // Skip invalid definitions
+
+		const size_t equals_index = definition.find('=');
+		if (equals_index != std::string::npos)
+			macros.emplace_back(
+				definition.substr(0, equals_index),
+				definition.substr(equals_index + 1));
+		else
+			macros.emplace_back(definition, "1");
+	}
 
 	std::set<std::filesystem::path> include_paths;
 	if (source_file.is_absolute())
@@ -407,41 +513,30 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		if (resolve_path(include_path))
 			include_paths.emplace(std::move(include_path));
 
+	// Only attributes that are not tracked as dependencies of the pre-processed output go into the source hash
+	// The contents of included files and values of referenced macros are verified separately (see 'check_effect_dependencies'), so that changes to them only affect the effects that actually use them
+	std::string attributes;
+	attributes += "app=" + g_target_executable_path.stem().u8string() + ';';
+	attributes += "version=" + std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION) + ';';
+	attributes += "performance_mode=" + std::string(_performance_mode ? "1" : "0") + ';';
 	for (const std::filesystem::path &include_path : include_paths)
-	{
-		std::error_code ec;
-		attributes += include_path.u8string();
-		for (const auto &entry : std::filesystem::directory_iterator(include_path, std::filesystem::directory_options::skip_permission_denied, ec))
-		{
-			const std::filesystem::path filename = entry.path().filename();
-			if (filename == source_file.filename() || filename.extension() == L".fxh")
-			{
-				attributes += ',';
-				attributes += filename.u8string();
-				attributes += '?';
-				attributes += std::to_string(entry.last_write_time(ec).time_since_epoch().count());
-			}
-		}
-		attributes += ';';
-	}
+		attributes += include_path.u8string() + ';';
+	// Adding or removing a macro can change the result of any '#ifdef' or 'defined()' check, so the names of all macros are part of the hash
+	for (const std::pair<std::string, std::string> &macro : macros)
+		attributes += macro.first + ';';
 
-	std::vector<std::string> preprocessor_definitions = _global_preprocessor_definitions;
-	preprocessor_definitions.insert(preprocessor_definitions.end(), _preset_preprocessor_definitions.begin(), _preset_preprocessor_definitions.end());
-	for (const std::string &definition : preprocessor_definitions)
-		attributes += definition + ';';
-
-	const size_t source_hash = std::hash<std::string>()(attributes);
+	const uint64_t source_hash = compute_cache_hash(attributes);
 
 	effect &effect = _effects[effect_index];
 	const std::string effect_name = source_file.filename().u8string();
-	if (source_file != effect.source_file || source_hash != effect.source_hash)
+	if (source_file != effect.source_file || source_hash != effect.source_hash || (!effect.dependencies.empty() && !check_effect_dependencies(effect.dependencies, macros)))
 	{
 		effect = {};
 		effect.source_file = source_file;
 		effect.source_hash = source_hash;
 	}
 
-	if (_effect_load_skipping && !_load_option_disable_skipping && !_worker_threads.empty()) // Only skip during 'load_effects'
+	if (_effect_load_skipping && !_load_option_disable_skipping && _reload_remaining_effects != std::numeric_limits<size_t>::max()) // Only skip during 'load_effects'
 	{
 		if (std::vector<std::string> techniques;
 			preset.get({}, "Techniques", techniques))
@@ -460,35 +555,11 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 	}
 
 	bool source_cached = false; std::string source;
-	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, source)) == false))
+	if (!effect.preprocessed && (preprocess_required || (source_cached = load_effect_cache(source_file, source_hash, macros, effect.dependencies, source)) == false))
 	{
 		reshadefx::preprocessor pp;
-		pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-		pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", _performance_mode ? "1" : "0");
-		pp.add_macro_definition("__VENDOR__", std::to_string(_vendor_id));
-		pp.add_macro_definition("__DEVICE__", std::to_string(_device_id));
-		pp.add_macro_definition("__RENDERER__", std::to_string(_renderer_id));
-		pp.add_macro_definition("__APPLICATION__", std::to_string( // Truncate hash to 32-bit, since lexer currently only supports 32-bit numbers anyway
-			std::hash<std::string>()(g_target_executable_path.stem().u8string()) & 0xFFFFFFFF));
-		pp.add_macro_definition("BUFFER_WIDTH", std::to_string(_width));
-		pp.add_macro_definition("BUFFER_HEIGHT", std::to_string(_height));
-		pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
-		pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
-		pp.add_macro_definition("BUFFER_COLOR_BIT_DEPTH", std::to_string(_color_bit_depth));
-
-		for (const std::string &definition : preprocessor_definitions)
-		{
-			if (definition.empty() || definition == "=")
-				continue; // Skip invalid definitions
-
-			const size_t equals_index = definition.find('=');
-			if (equals_index != std::string::npos)
-				pp.add_macro_definition(
-					definition.substr(0, equals_index),
-					definition.substr(equals_index + 1));
-			else
-				pp.add_macro_definition(definition);
-		}
+		for (const std::pair<std::string, std::string> &macro : macros)
+			pp.add_macro_definition(macro.first, macro.second);
 
 		for (const std::filesystem::path &include_path : include_paths)
 			pp.add_include_path(include_path);
@@ -513,7 +584,6 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		if (effect.preprocessed)
 		{
 			source = std::move(pp.output());
-			source_cached = save_effect_cache(source_file, source_hash, source);
 
 			// Keep track of used preprocessor definitions (so they can be displayed in the overlay)
 			effect.definitions.clear();
@@ -530,6 +600,23 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 			// Keep track of included files
 			effect.included_files = pp.included_files();
 			std::sort(effect.included_files.begin(), effect.included_files.end()); // Sort file names alphabetically
+
+			// Record the contents of all input files and the values of all referenced macros, so that the cache can be invalidated when any of them changes
+			effect.dependencies.clear();
+			effect.dependencies += "file " + std::to_string(compute_file_hash(source_file)) + ' ' + source_file.u8string() + '\n';
+			for (const std::filesystem::path &included_file : effect.included_files)
+				effect.dependencies += "file " + std::to_string(compute_file_hash(included_file)) + ' ' + included_file.u8string() + '\n';
+
+			std::vector<std::string> referenced_macros = pp.referenced_macros();
+			std::sort(referenced_macros.begin(), referenced_macros.end());
+			for (const std::string &name : referenced_macros)
+				// Macros defined in the effect code itself are covered by the file hashes already
+				if (const auto it = std::find_if(macros.begin(), macros.end(),
+					[&name](const std::pair<std::string, std::string> &macro) { return macro.first == name; });
+					it != macros.end())
+					effect.dependencies += "macro " + it->first + ' ' + it->second + '\n';
+
+			source_cached = save_effect_cache(source_file, source_hash, effect.dependencies, source);
 		}
 	}
 
@@ -547,24 +634,27 @@ bool reshade::runtime::load_effect(const std::filesystem::path &source_file, con
 		else
 			shader_model = 51; // D3D12
 
-		std::unique_ptr<reshadefx::codegen> codegen;
-		if ((_renderer_id & 0xF0000) == 0)
-			codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
-		else if (_renderer_id < 0x20000)
-			codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true));
-		else // Vulkan uses SPIR-V input
-			codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, false));
+		// Keep parser and code generator in a separate scope, so that all memory they allocated during compilation is released right after the result was written
+		{
+			std::unique_ptr<reshadefx::codegen> codegen;
+			if ((_renderer_id & 0xF0000) == 0)
+				codegen.reset(reshadefx::create_codegen_hlsl(shader_model, !_no_debug_info, _performance_mode));
+			else if (_renderer_id < 0x20000)
+				codegen.reset(reshadefx::create_codegen_glsl(!_no_debug_info, _performance_mode, false, true));
+			else // Vulkan uses SPIR-V input
+				codegen.reset(reshadefx::create_codegen_spirv(true, !_no_debug_info, _performance_mode, false, false));
 
-		reshadefx::parser parser;
+			reshadefx::parser parser;
 
-		// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
-		effect.compiled = parser.parse(std::move(source), codegen.get());
+			// Compile the pre-processed source code (try the compile even if the preprocessor step failed to get additional error information)
+			effect.compiled = parser.parse(std::move(source), codegen.get());
 
-		// Append parser errors to the error list
-		effect.errors  += parser.errors();
+			// Append parser errors to the error list
+			effect.errors  += parser.errors();
 
-		// Write result to effect module
-		codegen->write_result(effect.module);
+			// Write result to effect module
+			codegen->write_result(effect.module);
+		}
 
 		if (effect.compiled)
 		{
@@ -837,17 +927,34 @@ void reshade::runtime::load_effects()
 	_reload_remaining_effects = effect_files.size();
 
 	// Now that we have a list of files, load them in parallel
-	// Split workload into batches instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
-	const size_t num_splits = std::min<size_t>(effect_files.size(), std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
+	// Use a persistent pool of worker threads instead of launching a thread for every file to avoid launch overhead and stutters due to too many threads being in flight
+	if (_worker_pool == nullptr)
+		_worker_pool = std::make_unique<task_pool>(std::max<size_t>(std::thread::hardware_concurrency(), 2u) - 1);
+
+	// Start with the largest files, so that a single heavy effect does not end up delaying the entire reload by being picked up last
+	// Idle workers steal the remaining files from the others, so the total time is no longer bound by the slowest of a set of fixed batches
+	std::vector<std::pair<uintmax_t, size_t>> effect_file_order;
+	effect_file_order.reserve(effect_files.size());
+	for (size_t i = 0; i < effect_files.size(); ++i)
+	{
+		std::error_code ec;
+		const uintmax_t file_size = std::filesystem::file_size(effect_files[i], ec);
+		effect_file_order.emplace_back(ec ? 0 : file_size, i);
+	}
 
-	// Keep track of the spawned threads, so the runtime cannot be destroyed while they are still running
-	for (size_t n = 0; n < num_splits; ++n)
-		// Create copy of preset instead of reference, so it stays valid even if 'ini_file::load_cache' is called while effects are still being loaded
-		_worker_threads.emplace_back([this, effect_files, offset, num_splits, n, preset]() {
+	std::sort(effect_file_order.begin(), effect_file_order.end(),
+		[](const std::pair<uintmax_t, size_t> &lhs, const std::pair<uintmax_t, size_t> &rhs) { return lhs.first > rhs.first; });
+
+	// Create copy of preset instead of reference, so it stays valid even if 'ini_file::load_cache' is called while effects are still being loaded
+	const auto shared_preset = std::make_shared<const ini_file>(preset);
+
+	for (const std::pair<uintmax_t, size_t> &file : effect_file_order)
+		_worker_pool->submit([this, source_file = effect_files[file.second], effect_index = offset + file.second, shared_preset]() {
 			// Abort loading when initialization state changes (indicating that 'on_reset' was called in the meantime)
-			for (size_t i = 0; i < effect_files.size() && _is_initialized; ++i)
-				if (i * num_splits / effect_files.size() == n)
-					load_effect(effect_files[i], preset, offset + i);
+			if (!_is_initialized)
+				return;
+
+			load_effect(source_file, *shared_preset, effect_index);
 		});
 }
 void reshade::runtime::load_textures()
@@ -955,23 +1062,49 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 	effect &effect = _effects[effect_index];
 
+	// Collect uniform variables that need to be updated every frame, so that 'update_and_render_effects' does not have to look at all the others
+	for (size_t uniform_index = 0; uniform_index < effect.uniforms.size(); ++uniform_index)
+	{
+		const uniform &variable = effect.uniforms[uniform_index];
+
+		if (variable.special != special_uniform::none)
+		{
+			const auto insert_pos = std::upper_bound(_special_uniform_updates.begin(), _special_uniform_updates.end(), variable.special,
+				[](special_uniform special, const uniform_update &update) { return special < update.special; });
+			_special_uniform_updates.insert(insert_pos, { effect_index, uniform_index, variable.special, 0 });
+		}
+
+		if (variable.supports_toggle_key())
+		{
+			int num_items = 0;
+			const std::string_view ui_items = variable.annotation_as_string("ui_items");
+			for (size_t offset = 0, next; (next = ui_items.find('\0', offset)) != std::string::npos; offset = next + 1)
+				num_items++;
+
+			_toggle_key_uniform_updates.push_back({ effect_index, uniform_index, special_uniform::none, num_items });
+		}
+	}
+
 	// Compile shader modules
 	api::shader_format shader_format = _renderer_id & 0x10000 ? api::shader_format::glsl : _renderer_id & 0x20000 ? api::shader_format::spirv : api::shader_format::dxbc;
-	std::unordered_map<std::string, std::vector<char>> entry_points;
+	// Pipelines are created later (see 'update_pipeline_creation'), so the shader code they reference is kept alive with them
+	const auto shaders = std::make_shared<pipeline_batch::shader_data>();
+	auto &entry_points = shaders->entry_points;
 
-	for (const reshadefx::entry_point &entry_point : effect.module.entry_points)
+	const size_t num_entry_points = effect.module.entry_points.size();
+	std::vector<api::shader_stage> entry_point_types(num_entry_points, api::shader_stage::all);
+	for (size_t i = 0; i < num_entry_points; ++i)
 	{
-		api::shader_stage type = api::shader_stage::all;
-		switch (entry_point.type)
+		switch (effect.module.entry_points[i].type)
 		{
 		case reshadefx::shader_type::vs:
-			type = api::shader_stage::vertex;
+			entry_point_types[i] = api::shader_stage::vertex;
 			break;
 		case reshadefx::shader_type::ps:
-			type = api::shader_stage::pixel;
+			entry_point_types[i] = api::shader_stage::pixel;
 			break;
 		case reshadefx::shader_type::cs:
-			type = api::shader_stage::compute;
+			entry_point_types[i] = api::shader_stage::compute;
 			if (!device->check_capability(api::device_caps::compute_shader))
 			{
 				effect.errors += "Compute shaders are not supported in D3D9.";
@@ -979,17 +1112,46 @@ bool reshade::runtime::init_effect(size_t effect_index)
 			}
 			break;
 		}
+	}
+
+	// Compile (or load from cache) all entry points in parallel and only join before creating any pipelines
+	// Every entry point writes to its own output, so that results can be merged in order afterwards
+	std::vector<std::vector<char>> entry_point_code(num_entry_points);
+	std::vector<std::string> entry_point_assembly(num_entry_points);
+	std::vector<std::string> entry_point_errors(num_entry_points);
+	std::unique_ptr<bool[]> entry_point_compiled(new bool[num_entry_points]);
+
+	const auto compile_entry_point = [&](size_t i) {
+		entry_point_compiled[i] = compile_effect(effect, entry_point_types[i], effect.module.entry_points[i].name, entry_point_code[i], entry_point_assembly[i], entry_point_errors[i]);
+	};
+
+	if (_worker_pool != nullptr)
+		_worker_pool->parallel_for(num_entry_points, compile_entry_point);
+	else
+		for (size_t i = 0; i < num_entry_points; ++i)
+			compile_entry_point(i);
+
+	for (size_t i = 0; i < num_entry_points; ++i)
+	{
+		const std::string &entry_point_name = effect.module.entry_points[i].name;
+
+		effect.errors += entry_point_errors[i];
 
-		if (!compile_effect(effect, type, entry_point.name, entry_points[entry_point.name]))
+		if (!entry_point_compiled[i])
 		{
-			LOG(ERROR) << "Failed to create shader module for effect file '" << effect.source_file << "' entry point '" << entry_point.name << "'!";
+			LOG(ERROR) << "Failed to create shader module for effect file '" << effect.source_file << "' entry point '" << entry_point_name << "'!";
 			return false;
 		}
+
+		if (!entry_point_assembly[i].empty())
+			effect.assembly[entry_point_name] = std::move(entry_point_assembly[i]);
+
+		entry_points[entry_point_name] = std::move(entry_point_code[i]);
 	}
 
 	// Build specialization constants
-	std::vector<uint32_t> spec_data;
-	std::vector<uint32_t> spec_constants;
+	std::vector<uint32_t> &spec_data = shaders->spec_data;
+	std::vector<uint32_t> &spec_constants = shaders->spec_constants;
 	for (const reshadefx::uniform_info &constant : effect.module.spec_constants)
 	{
 		const uint32_t id = static_cast<uint32_t>(spec_constants.size());
@@ -1021,6 +1183,9 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 		device->set_debug_name(effect.cb, "ReShade constant buffer");
 
+		// The buffer contents are undefined after creation, so all uniform data has to be uploaded once
+		effect.mark_uniform_data_dirty(0, effect.uniform_data_storage.size());
+
 		api::descriptor_range range;
 		range.binding = 0;
 		range.dx_shader_register = 0; // b0 (global constant buffer)
@@ -1162,6 +1327,11 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 		technique.passes_data.resize(technique.passes.size());
 
+		technique.pending_pipelines = std::make_shared<pipeline_batch>();
+		technique.pending_pipelines->shaders = shaders;
+		technique.pending_pipelines->descs.reserve(technique.passes.size());
+		technique.pending_pipelines->pipelines.resize(technique.passes.size());
+
 		// Offset index so that a query exists for each command frame and two subsequent ones are used for before/after stamps
 		technique.query_base_index = technique_index++ * 2 * NUM_QUERY_FRAMES;
 
@@ -1177,48 +1347,44 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				api::pipeline_desc desc = { api::pipeline_type::compute };
 				desc.layout = effect.layout;
 
-				const auto &cs = entry_points.at(pass_info.cs_entry_point);
-				desc.compute.shader.code = cs.data();
-				desc.compute.shader.code_size = cs.size();
+				const auto &cs = *entry_points.find(pass_info.cs_entry_point);
+				desc.compute.shader.code = cs.second.data();
+				desc.compute.shader.code_size = cs.second.size();
 				desc.compute.shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.compute.shader.entry_point = pass_info.cs_entry_point.c_str();
+					desc.compute.shader.entry_point = cs.first.c_str();
 					desc.compute.shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.compute.shader.spec_constant_ids = spec_constants.data();
 					desc.compute.shader.spec_constant_values = spec_data.data();
 				}
 
-				if (!device->create_pipeline(desc, &pass_data.pipeline))
-				{
-					LOG(ERROR) << "Failed to create compute pipeline for pass " << pass_index << " in technique '" << technique.name << "'!";
-					return false;
-				}
+				technique.pending_pipelines->descs.push_back(desc);
 			}
 			else
 			{
 				api::pipeline_desc desc = { api::pipeline_type::graphics };
 				desc.layout = effect.layout;
 
-				const auto &vs = entry_points.at(pass_info.vs_entry_point);
-				desc.graphics.vertex_shader.code = vs.data();
-				desc.graphics.vertex_shader.code_size = vs.size();
+				const auto &vs = *entry_points.find(pass_info.vs_entry_point);
+				desc.graphics.vertex_shader.code = vs.second.data();
+				desc.graphics.vertex_shader.code_size = vs.second.size();
 				desc.graphics.vertex_shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.graphics.vertex_shader.entry_point = pass_info.vs_entry_point.c_str();
+					desc.graphics.vertex_shader.entry_point = vs.first.c_str();
 					desc.graphics.vertex_shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.graphics.vertex_shader.spec_constant_ids = spec_constants.data();
 					desc.graphics.vertex_shader.spec_constant_values = spec_data.data();
 				}
 
-				const auto &ps = entry_points.at(pass_info.ps_entry_point);
-				desc.graphics.pixel_shader.code = ps.data();
-				desc.graphics.pixel_shader.code_size = ps.size();
+				const auto &ps = *entry_points.find(pass_info.ps_entry_point);
+				desc.graphics.pixel_shader.code = ps.second.data();
+				desc.graphics.pixel_shader.code_size = ps.second.size();
 				desc.graphics.pixel_shader.format = shader_format;
 				if (shader_format == api::shader_format::spirv)
 				{
-					desc.graphics.pixel_shader.entry_point = pass_info.ps_entry_point.c_str();
+					desc.graphics.pixel_shader.entry_point = ps.first.c_str();
 					desc.graphics.pixel_shader.num_spec_constants = static_cast<uint32_t>(effect.module.spec_constants.size());
 					desc.graphics.pixel_shader.spec_constant_ids = spec_constants.data();
 					desc.graphics.pixel_shader.spec_constant_values = spec_data.data();
@@ -1379,11 +1545,7 @@ bool reshade::runtime::init_effect(size_t effect_index)
 				depth_stencil_state.front_stencil_pass_op = depth_stencil_state.back_stencil_pass_op;
 				depth_stencil_state.front_stencil_func = depth_stencil_state.back_stencil_func;
 
-				if (!device->create_pipeline(desc, &pass_data.pipeline))
-				{
-					LOG(ERROR) << "Failed to create graphics pipeline for pass " << pass_index << " in technique '" << technique.name << "'!";
-					return false;
-				}
+				technique.pending_pipelines->descs.push_back(desc);
 			}
 
 			if (effect.module.num_sampler_bindings != 0)
@@ -1495,6 +1657,108 @@ bool reshade::runtime::init_effect(size_t effect_index)
 
 	return true;
 }
+void reshade::runtime::update_pipeline_creation()
+{
+	api::device *const device = get_device();
+
+	const bool concurrent = _worker_pool != nullptr && device->check_capability(api::device_caps::concurrent_pipeline_creation);
+	const auto time_started = std::chrono::high_resolution_clock::now();
+	bool created_any = false;
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.pending_pipelines == nullptr || !_effects[tech.effect_index].compiled)
+			continue;
+
+		const std::shared_ptr<pipeline_batch> batch = tech.pending_pipelines;
+		const size_t num_pipelines = batch->descs.size();
+
+		if (concurrent)
+		{
+			for (; batch->num_started < num_pipelines; ++batch->num_started)
+			{
+				_worker_pool->submit([device, batch, index = batch->num_started]() {
+					if (!batch->cancelled)
+						device->create_pipeline(batch->descs[index], &batch->pipelines[index]);
+					batch->num_finished++;
+				});
+			}
+		}
+		else
+		{
+			// Spread creation across frames to avoid long stalls, but always create at least one pipeline per frame so that loading progresses
+			while (batch->num_started < num_pipelines && (!created_any || _pipeline_creation_budget == 0 ||
+				std::chrono::high_resolution_clock::now() - time_started < std::chrono::milliseconds(_pipeline_creation_budget)))
+			{
+				const size_t index = batch->num_started++;
+				device->create_pipeline(batch->descs[index], &batch->pipelines[index]);
+				batch->num_finished++;
+				created_any = true;
+			}
+		}
+
+		if (batch->num_finished != num_pipelines)
+			continue;
+
+		// All pipelines of this technique are done, so publish them together
+		bool success = true;
+		for (size_t pass_index = 0; pass_index < num_pipelines; ++pass_index)
+		{
+			tech.passes_data[pass_index].pipeline = batch->pipelines[pass_index];
+
+			if (batch->pipelines[pass_index].handle == 0)
+			{
+				LOG(ERROR) << "Failed to create " << (batch->descs[pass_index].type == api::pipeline_type::compute ? "compute" : "graphics") << " pipeline for pass " << pass_index << " in technique '" << tech.name << "'!";
+				success = false;
+			}
+		}
+
+		tech.pending_pipelines.reset();
+
+		if (!success)
+		{
+			_effects[tech.effect_index].compiled = false;
+
+			// Disable all techniques belonging to this effect
+			for (technique &effect_tech : _techniques)
+				if (effect_tech.effect_index == tech.effect_index)
+					disable_technique(effect_tech);
+
+			_last_reload_successfull = false;
+		}
+	}
+}
+void reshade::runtime::cancel_pipeline_creation(size_t effect_index)
+{
+	api::device *const device = get_device();
+
+	bool wait_for_workers = false;
+	for (technique &tech : _techniques)
+	{
+		if (tech.pending_pipelines == nullptr || (effect_index != std::numeric_limits<size_t>::max() && tech.effect_index != effect_index))
+			continue;
+
+		tech.pending_pipelines->cancelled = true;
+		wait_for_workers |= tech.pending_pipelines->num_finished != tech.pending_pipelines->num_started;
+	}
+
+	// Pipelines that are currently being created on a worker thread cannot be interrupted, so have to wait for them
+	if (wait_for_workers)
+		_worker_pool->wait();
+
+	for (technique &tech : _techniques)
+	{
+		if (tech.pending_pipelines == nullptr || tech.pending_pipelines->cancelled == false)
+			continue;
+
+		const pipeline_batch &batch = *tech.pending_pipelines;
+		for (size_t index = 0; index < batch.pipelines.size(); ++index)
+			if (batch.pipelines[index].handle != 0)
+				device->destroy_pipeline(batch.descs[index].type, batch.pipelines[index]);
+
+		tech.pending_pipelines.reset();
+	}
+}
 bool reshade::runtime::init_texture(texture &tex)
 {
 	api::device *const device = get_device();
@@ -1679,6 +1943,8 @@ void reshade::runtime::unload_effect(size_t effect_index)
 	// Make sure no effect resources are currently in use
 	device->wait_idle();
 
+	cancel_pipeline_creation(effect_index);
+
 	for (technique &tech : _techniques)
 	{
 		if (tech.effect_index != effect_index)
@@ -1741,6 +2007,10 @@ void reshade::runtime::unload_effect(size_t effect_index)
 		[effect_index](const technique &tech) {
 			return tech.effect_index == effect_index;
 		}), _techniques.end());
+	// Stop updating uniform variables belonging to this effect
+	const auto is_effect_update = [effect_index](const uniform_update &update) { return update.effect_index == effect_index; };
+	_special_uniform_updates.erase(std::remove_if(_special_uniform_updates.begin(), _special_uniform_updates.end(), is_effect_update), _special_uniform_updates.end());
+	_toggle_key_uniform_updates.erase(std::remove_if(_toggle_key_uniform_updates.begin(), _toggle_key_uniform_updates.end(), is_effect_update), _toggle_key_uniform_updates.end());
 
 	_effects[effect_index].rendering = 0;
 	// Do not clear effect here, since it is common to be re-used immediately
@@ -1752,6 +2022,8 @@ void reshade::runtime::unload_effects()
 	// Make sure no effect resources are currently in use
 	device->wait_idle();
 
+	cancel_pipeline_creation(std::numeric_limits<size_t>::max());
+
 	for (technique &tech : _techniques)
 	{
 		for (size_t pass_index = 0; pass_index < tech.passes_data.size(); ++pass_index)
@@ -1789,10 +2061,8 @@ void reshade::runtime::unload_effects()
 #endif
 
 	// Make sure no threads are still accessing effect data
-	for (std::thread &thread : _worker_threads)
-		if (thread.joinable())
-			thread.join();
-	_worker_threads.clear();
+	if (_worker_pool != nullptr)
+		_worker_pool->wait();
 
 	// Destroy all textures
 	for (texture &tex : _textures)
@@ -1801,6 +2071,8 @@ void reshade::runtime::unload_effects()
 	_textures_loaded = false;
 	// Clean up all techniques
 	_techniques.clear();
+	_special_uniform_updates.clear();
+	_toggle_key_uniform_updates.clear();
 
 	// Reset the effect list after all resources have been destroyed
 	_effects.clear();
@@ -1852,7 +2124,7 @@ void reshade::runtime::reload_effects()
 	load_effects();
 }
 
-bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const uint64_t hash, const std::vector<std::pair<std::string, std::string>> &macros, std::string &dependencies, std::string &source) const
 {
 	if (_no_effect_cache)
 		return false;
@@ -1867,9 +2139,22 @@ bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_fil
 	source.resize(size);
 	const BOOL result = ReadFile(file, source.data(), size, &size, nullptr);
 	CloseHandle(file);
-	return result != FALSE;
+	if (result == FALSE)
+		return false;
+
+	// The file starts with a list of dependencies, each on a separate line starting with "// " and terminated by an empty "//" line
+	dependencies.clear();
+	size_t offset = 0;
+	for (size_t next; source.compare(offset, 3, "// ") == 0 && (next = source.find('\n', offset)) != std::string::npos; offset = next + 1)
+		dependencies.append(source, offset + 3, next + 1 - offset - 3);
+	if (source.compare(offset, 3, "//\n") != 0)
+		return false;
+	source.erase(0, offset + 3);
+
+	// Discard the cached source if any file it was generated from was modified or a referenced macro changed its value
+	return check_effect_dependencies(dependencies, macros);
 }
-bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const
+bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const uint64_t hash, std::vector<char> &cso, std::string &dasm) const
 {
 	if (_no_effect_cache)
 		return false;
@@ -1903,7 +2188,7 @@ bool reshade::runtime::load_effect_cache(const std::filesystem::path &source_fil
 
 	return true;
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const uint64_t hash, const std::string &dependencies, const std::string &source) const
 {
 	if (_no_effect_cache)
 		return false;
@@ -1911,15 +2196,23 @@ bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_fil
 	std::filesystem::path path = g_reshade_base_path / _intermediate_cache_path;
 	path /= std::filesystem::u8path("reshade-" + source_file.stem().u8string() + '-' + std::to_string(_renderer_id) + '-' + std::to_string(hash) + ".i");
 
-	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_NEW, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	std::string data;
+	data.reserve(dependencies.size() + source.size() + 64);
+	for (size_t offset = 0, next; (next = dependencies.find('\n', offset)) != std::string::npos; offset = next + 1)
+		data += "// ", data.append(dependencies, offset, next + 1 - offset);
+	data += "//\n";
+	data += source;
+
+	// The file name does not change when dependencies change, so need to overwrite any existing file
+	const HANDLE file = CreateFileW(path.c_str(), FILE_GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_ARCHIVE | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
 	if (file == INVALID_HANDLE_VALUE)
 		return false;
-	DWORD size = static_cast<DWORD>(source.size());
-	const BOOL result = WriteFile(file, source.data(), size, &size, nullptr);
+	DWORD size = static_cast<DWORD>(data.size());
+	const BOOL result = WriteFile(file, data.data(), size, &size, nullptr);
 	CloseHandle(file);
 	return result != FALSE;
 }
-bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const
+bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const uint64_t hash, const std::vector<char> &cso, const std::string &dasm) const
 {
 	if (_no_effect_cache)
 		return false;
@@ -1952,6 +2245,21 @@ bool reshade::runtime::save_effect_cache(const std::filesystem::path &source_fil
 	return true;
 }
 
+uint64_t reshade::runtime::compute_cache_hash(const effect &effect, const std::string &entry_point, const std::string_view attributes)
+{
+	// The code generated from the same source may differ between versions, so include the version in the hash too
+	uint64_t hash = compute_cache_hash(std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	hash = compute_cache_hash(attributes, compute_cache_hash(effect.preamble, hash));
+
+	const auto entry_point_info = std::find_if(effect.module.entry_points.begin(), effect.module.entry_points.end(),
+		[&entry_point](const reshadefx::entry_point &info) { return info.name == entry_point; });
+	// Fall back to hashing the entire generated code if the parser did not compute a hash for this entry point
+	if (entry_point_info == effect.module.entry_points.end() || entry_point_info->source_hash == 0)
+		return compute_cache_hash(effect.module.hlsl, hash);
+
+	return compute_cache_hash(std::string_view(reinterpret_cast<const char *>(&entry_point_info->source_hash), sizeof(uint64_t)), hash);
+}
+
 void reshade::runtime::clear_effect_cache()
 {
 	// Find all cached effect files and delete them
@@ -1978,11 +2286,9 @@ void reshade::runtime::update_and_render_effects()
 
 	if (_reload_remaining_effects == 0)
 	{
-		// Clear the thread list now that they all have finished
-		for (std::thread &thread : _worker_threads)
-			if (thread.joinable())
-				thread.join(); // Threads have exited, but still need to join them prior to destruction
-		_worker_threads.clear();
+		// Wait for the last tasks to return (they may still be writing to the log after reducing the remaining effects count)
+		if (_worker_pool != nullptr)
+			_worker_pool->wait();
 
 		// Finished loading effects, so apply preset to figure out which ones need compiling
 		load_current_preset();
@@ -2111,6 +2417,8 @@ void reshade::runtime::update_and_render_effects()
 		load_textures();
 	}
 
+	update_pipeline_creation();
+
 #ifdef NDEBUG
 	// Lock input so it cannot be modified by other threads while we are reading it here
 	// TODO: This does not catch input happening between now and 'on_present'
@@ -2125,49 +2433,63 @@ void reshade::runtime::update_and_render_effects()
 		return;
 
 	// Update special uniform variables
-	for (effect &effect : _effects)
+	if (!_ignore_shortcuts)
 	{
-		if (!effect.rendering)
-			continue;
-
-		for (uniform &variable : effect.uniforms)
+		for (const uniform_update &update : _toggle_key_uniform_updates)
 		{
-			if (!_ignore_shortcuts && _input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
-			{
-				assert(variable.supports_toggle_key());
+			effect &effect = _effects[update.effect_index];
+			if (!effect.rendering)
+				continue;
 
-				// Change to next value if the associated shortcut key was pressed
-				switch (variable.type.base)
+			uniform &variable = effect.uniforms[update.uniform_index];
+			if (!_input->is_key_pressed(variable.toggle_key_data, _force_shortcut_modifiers))
+				continue;
+
+			assert(variable.supports_toggle_key());
+
+			// Change to next value if the associated shortcut key was pressed
+			switch (variable.type.base)
+			{
+				case reshadefx::type::t_bool:
 				{
-					case reshadefx::type::t_bool:
-					{
-						bool data;
-						get_uniform_value(variable, &data, 1);
-						set_uniform_value(variable, !data);
-						break;
-					}
-					case reshadefx::type::t_int:
-					case reshadefx::type::t_uint:
-					{
-						int data[4];
-						get_uniform_value(variable, data, 4);
-						const std::string_view ui_items = variable.annotation_as_string("ui_items");
-						int num_items = 0;
-						for (size_t offset = 0, next; (next = ui_items.find('\0', offset)) != std::string::npos; offset = next + 1)
-							num_items++;
-						data[0] = (data[0] + 1 >= num_items) ? 0 : data[0] + 1;
-						set_uniform_value(variable, data, 4);
-						break;
-					}
+					bool data;
+					get_uniform_value(variable, &data, 1);
+					set_uniform_value(variable, !data);
+					break;
+				}
+				case reshadefx::type::t_int:
+				case reshadefx::type::t_uint:
+				{
+					int data[4];
+					get_uniform_value(variable, data, 4);
+					data[0] = (data[0] + 1 >= update.num_items) ? 0 : data[0] + 1;
+					set_uniform_value(variable, data, 4);
+					break;
 				}
-				save_current_preset();
 			}
+			save_current_preset();
+		}
+	}
+
+	{
+		// Values that are the same for all variables of a kind are only computed once
+		const float frame_time = _last_frame_duration.count() * 1e-6f;
+		const unsigned long long timer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count();
+		int date[4] = {};
+
+		for (const uniform_update &update : _special_uniform_updates)
+		{
+			effect &effect = _effects[update.effect_index];
+			if (!effect.rendering)
+				continue;
 
-			switch (variable.special)
+			uniform &variable = effect.uniforms[update.uniform_index];
+
+			switch (update.special)
 			{
 				case special_uniform::frame_time:
 				{
-					set_uniform_value(variable, _last_frame_duration.count() * 1e-6f);
+					set_uniform_value(variable, frame_time);
 					break;
 				}
 				case special_uniform::frame_count:
@@ -2217,21 +2539,22 @@ void reshade::runtime::update_and_render_effects()
 				}
 				case special_uniform::date:
 				{
-					const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-					tm tm; localtime_s(&tm, &t);
-
-					const int value[4] = {
-						tm.tm_year + 1900,
-						tm.tm_mon + 1,
-						tm.tm_mday,
-						tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec
-					};
-					set_uniform_value(variable, value, 4);
+					// Only query the date once per frame, no matter how many variables use it
+					if (date[0] == 0)
+					{
+						const std::time_t t = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+						tm tm; localtime_s(&tm, &t);
+
+						date[0] = tm.tm_year + 1900;
+						date[1] = tm.tm_mon + 1;
+						date[2] = tm.tm_mday;
+						date[3] = tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+					}
+					set_uniform_value(variable, date, 4);
 					break;
 				}
 				case special_uniform::timer:
 				{
-					const unsigned long long timer_ms = std::chrono::duration_cast<std::chrono::milliseconds>(_last_present_time - _start_time).count();
 					set_uniform_value(variable, static_cast<unsigned int>(timer_ms));
 					break;
 				}
@@ -2345,7 +2668,7 @@ void reshade::runtime::update_and_render_effects()
 				disable_technique(technique);
 		}
 
-		if (technique.passes_data.empty() || !technique.enabled)
+		if (technique.passes_data.empty() || technique.pending_pipelines != nullptr || !technique.enabled)
 			continue; // Ignore techniques that are not fully loaded or currently disabled
 
 		const auto time_technique_started = std::chrono::high_resolution_clock::now();
@@ -2397,11 +2720,39 @@ void reshade::runtime::render_technique(technique &technique)
 	// Setup shader constants
 	if (effect.cb.handle != 0)
 	{
-		if (void *mapped_ptr;
-			device->map_resource(effect.cb, 0, api::map_access::write_discard, &mapped_ptr))
+		// Only upload uniform data that changed since the last upload, which means this usually happens at most once per frame, even for effects with multiple techniques
+		if (effect.uniform_data_dirty_begin != effect.uniform_data_dirty_end)
 		{
-			std::memcpy(mapped_ptr, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
-			device->unmap_resource(effect.cb, 0);
+			const size_t dirty_offset = effect.uniform_data_dirty_begin;
+			const size_t dirty_size = effect.uniform_data_dirty_end - effect.uniform_data_dirty_begin;
+
+			switch (device->get_api())
+			{
+			case api::device_api::d3d12:
+			case api::device_api::vulkan:
+				// Buffers in host visible memory are mapped directly, so can be updated partially
+				if (uint8_t *mapped_ptr;
+					device->map_resource(effect.cb, 0, api::map_access::write_only, reinterpret_cast<void **>(&mapped_ptr)))
+				{
+					std::memcpy(mapped_ptr + dirty_offset, effect.uniform_data_storage.data() + dirty_offset, dirty_size);
+					device->unmap_resource(effect.cb, 0);
+				}
+				break;
+			case api::device_api::opengl:
+				device->upload_buffer_region(effect.uniform_data_storage.data() + dirty_offset, effect.cb, dirty_offset, dirty_size);
+				break;
+			default:
+				// Dynamic buffers in D3D10 and D3D11 can only be updated by discarding their entire contents
+				if (void *mapped_ptr;
+					device->map_resource(effect.cb, 0, api::map_access::write_discard, &mapped_ptr))
+				{
+					std::memcpy(mapped_ptr, effect.uniform_data_storage.data(), effect.uniform_data_storage.size());
+					device->unmap_resource(effect.cb, 0);
+				}
+				break;
+			}
+
+			effect.uniform_data_dirty_begin = effect.uniform_data_dirty_end = 0;
 		}
 
 		cmd_list->bind_descriptor_sets(api::pipeline_type::graphics, effect.layout, 0, 1, &effect.cb_set);
@@ -2633,6 +2984,7 @@ void reshade::runtime::load_config()
 	config.get("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.get("GENERAL", "NoEffectCache", _no_effect_cache);
 	config.get("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.get("GENERAL", "PipelineCreationBudget", _pipeline_creation_budget);
 
 	config.get("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.get("GENERAL", "PerformanceMode", _performance_mode);
@@ -2685,6 +3037,7 @@ void reshade::runtime::save_config() const
 	config.set("GENERAL", "NoDebugInfo", _no_debug_info);
 	config.set("GENERAL", "NoEffectCache", _no_effect_cache);
 	config.set("GENERAL", "NoReloadOnInit", _no_reload_on_init);
+	config.set("GENERAL", "PipelineCreationBudget", _pipeline_creation_budget);
 
 	config.set("GENERAL", "EffectSearchPaths", _effect_search_paths);
 	config.set("GENERAL", "PerformanceMode", _performance_mode);
@@ -3192,6 +3545,8 @@ void reshade::runtime::set_uniform_value(uniform &variable, const uint8_t *data,
 	{
 		std::memcpy(data_storage.data() + variable.offset, data, size);
 	}
+
+	_effects[variable.effect_index].mark_uniform_data_dirty(variable.offset, variable.size);
 }
 void reshade::runtime::set_uniform_value(uniform &variable, const bool *values, size_t count, size_t array_index)
 {
@@ -3263,6 +3618,7 @@ void reshade::runtime::reset_uniform_value(uniform &variable)
 	if (!variable.has_initializer_value)
 	{
 		std::memset(_effects[variable.effect_index].uniform_data_storage.data() + variable.offset, 0, variable.size);
+		_effects[variable.effect_index].mark_uniform_data_dirty(variable.offset, variable.size);
 		return;
 	}
 
@@ -23,10 +23,12 @@ struct ImGuiContext;
 namespace reshade
 {
 	class ini_file; // Forward declarations to avoid excessive #include
+	class task_pool;
 	struct effect;
 	struct uniform;
 	struct texture;
 	struct technique;
+	struct uniform_update;
 
 	/// <summary>
 	/// Platform independent base class for the main ReShade runtime.
@@ -168,6 +170,17 @@ namespace reshade
 		/// </summary>
 		void unload_effects();
 
+		/// <summary>
+		/// Continue creating the pipelines of initialized effects and publish those of techniques whose pipelines are all finished.
+		/// Pipelines are created on the worker threads if the device supports that, otherwise on this thread limited to a time budget per frame.
+		/// </summary>
+		void update_pipeline_creation();
+		/// <summary>
+		/// Stop creating pipelines for the specified effect and destroy those that were already created, but not published yet.
+		/// </summary>
+		/// <param name="effect_index">The ID of the effect, or <c>std::numeric_limits&lt;size_t&gt;::max()</c> to cancel for all effects.</param>
+		void cancel_pipeline_creation(size_t effect_index);
+
 		/// <summary>
 		/// Reload only the specified effect.
 		/// </summary>
@@ -180,19 +193,40 @@ namespace reshade
 
 		/// <summary>
 		/// Load compiled effect data from the disk cache.
+		/// Pre-processed source code is only returned if none of the files and macro definitions it was generated from changed since it was saved.
 		/// </summary>
-		bool load_effect_cache(const std::filesystem::path &source_file, const size_t hash, std::string &source) const;
-		bool load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, std::vector<char> &cso, std::string &dasm) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const uint64_t hash, const std::vector<std::pair<std::string, std::string>> &macros, std::string &dependencies, std::string &source) const;
+		bool load_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const uint64_t hash, std::vector<char> &cso, std::string &dasm) const;
 		/// <summary>
 		/// Save compiled effect data to the disk cache.
 		/// </summary>
-		bool save_effect_cache(const std::filesystem::path &source_file, const size_t hash, const std::string &source) const;
-		bool save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const size_t hash, const std::vector<char> &cso, const std::string &dasm) const;
+		bool save_effect_cache(const std::filesystem::path &source_file, const uint64_t hash, const std::string &dependencies, const std::string &source) const;
+		bool save_effect_cache(const std::filesystem::path &source_file, const std::string &entry_point, const uint64_t hash, const std::vector<char> &cso, const std::string &dasm) const;
 		/// <summary>
 		/// Remove all compiled effect data from disk.
 		/// </summary>
 		void clear_effect_cache();
 
+		/// <summary>
+		/// Compute a stable 64-bit hash (FNV-1a) of the specified data, which is used to identify compiled effect data in the disk cache.
+		/// </summary>
+		/// <param name="data">The data to hash.</param>
+		/// <param name="hash">A previous hash value to continue from, which allows combining multiple inputs.</param>
+		static uint64_t compute_cache_hash(const std::string_view data, uint64_t hash = 14695981039346656037ull)
+		{
+			for (const char c : data)
+				hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+			return hash;
+		}
+		/// <summary>
+		/// Compute the hash identifying the compiled code of an entry point of the specified <paramref name="effect"/> in the disk cache.
+		/// Only the code that entry point references is hashed, so that the cached result remains valid when other parts of the effect are modified.
+		/// </summary>
+		/// <param name="effect">The effect containing the entry point.</param>
+		/// <param name="entry_point">The name of the entry point function.</param>
+		/// <param name="attributes">Additional options the entry point is compiled with (profile, flags, ...).</param>
+		static uint64_t compute_cache_hash(const effect &effect, const std::string &entry_point, const std::string_view attributes);
+
 		/// <summary>
 		/// Load image files and update textures with image data.
 		/// </summary>
@@ -210,7 +244,17 @@ namespace reshade
 
 		void update_texture_bindings(const char *semantic, api::resource_view srv) final;
 
-		virtual bool compile_effect(effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &out) = 0;
+		/// <summary>
+		/// Compiles the specified <paramref name="entry_point"/> of an effect with the back-end shader compiler.
+		/// This is called for multiple entry points of the same effect in parallel, so must not modify any shared state.
+		/// </summary>
+		/// <param name="effect">The effect containing the entry point.</param>
+		/// <param name="type">The shader stage of the entry point.</param>
+		/// <param name="entry_point">The name of the entry point function.</param>
+		/// <param name="out">Output shader code in the format the device expects.</param>
+		/// <param name="assembly">Output disassembly of the shader code, if available.</param>
+		/// <param name="errors">Output warning and error messages.</param>
+		virtual bool compile_effect(const effect &effect, api::shader_stage type, const std::string &entry_point, std::vector<char> &out, std::string &assembly, std::string &errors) = 0;
 
 		virtual api::resource_view get_backbuffer(bool) { return { 0 }; }
 		virtual api::resource get_backbuffer_resource() { return { 0 }; }
@@ -312,6 +356,7 @@ namespace reshade
 		bool _no_debug_info = 0;
 		bool _no_effect_cache = false;
 		bool _no_reload_on_init = false;
+		unsigned int _pipeline_creation_budget = 4;
 		bool _effect_load_skipping = false;
 		bool _load_option_disable_skipping = false;
 		std::atomic<int> _last_reload_successfull = true;
@@ -322,7 +367,7 @@ namespace reshade
 		std::vector<size_t> _reload_compile_queue;
 		std::atomic<size_t> _reload_remaining_effects = 0;
 		std::mutex _reload_mutex;
-		std::vector<std::thread> _worker_threads;
+		std::unique_ptr<task_pool> _worker_pool;
 		std::vector<std::string> _global_preprocessor_definitions;
 		std::vector<std::string> _preset_preprocessor_definitions;
 		std::vector<std::filesystem::path> _effect_search_paths;
@@ -363,6 +408,9 @@ namespace reshade
 		api::resource_view _empty_texture_view = {};
 		std::unordered_map<size_t, api::sampler> _effect_sampler_states;
 		std::unordered_map<std::string, api::resource_view> _texture_semantic_bindings;
+		// Uniform variables that are updated every frame, built in 'init_effect' (special ones are sorted by kind so that similar values are written together)
+		std::vector<uniform_update> _special_uniform_updates;
+		std::vector<uniform_update> _toggle_key_uniform_updates;
 
 #if RESHADE_GUI
 		struct editor_instance
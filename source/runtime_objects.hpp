@@ -6,6 +6,8 @@
 #pragma once
 
 #include "effect_module.hpp"
+#include <atomic>
+#include <memory>
 
 namespace reshade
 {
@@ -29,6 +31,30 @@ namespace reshade
 		overlay_hovered,
 	};
 
+	/// <summary>
+	/// The pipelines of a technique that are still being created.
+	/// The technique is only rendered once all of them finished, at which point they are published to its pass data at once.
+	/// </summary>
+	struct pipeline_batch
+	{
+		/// <summary>
+		/// Compiled shader code and specialization constants of an effect, which the pipeline descriptions point into.
+		/// </summary>
+		struct shader_data
+		{
+			std::unordered_map<std::string, std::vector<char>> entry_points;
+			std::vector<uint32_t> spec_data;
+			std::vector<uint32_t> spec_constants;
+		};
+
+		std::shared_ptr<const shader_data> shaders;
+		std::vector<api::pipeline_desc> descs;
+		std::vector<api::pipeline> pipelines;
+		size_t num_started = 0;
+		std::atomic<size_t> num_finished = 0;
+		std::atomic<bool> cancelled = false;
+	};
+
 	template <typename T, size_t SAMPLES>
 	class moving_average
 	{
@@ -142,6 +168,18 @@ namespace reshade
 		uint32_t toggle_key_data[4] = {};
 	};
 
+	/// <summary>
+	/// Reference to a uniform variable that is updated every frame, because it has a special source or can be toggled with a key.
+	/// </summary>
+	struct uniform_update
+	{
+		size_t effect_index;
+		size_t uniform_index;
+		special_uniform special;
+		// Number of items to cycle through when the toggle key of an integer variable is pressed
+		int num_items;
+	};
+
 	struct technique final : reshadefx::technique_info
 	{
 		technique(const reshadefx::technique_info &init) : technique_info(init) {}
@@ -189,6 +227,7 @@ namespace reshade
 
 		bool has_compute_passes = false;
 		std::vector<pass_data> passes_data;
+		std::shared_ptr<pipeline_batch> pending_pipelines;
 		uint32_t query_base_index = 0;
 	};
 
@@ -201,13 +240,33 @@ namespace reshade
 		std::string errors;
 		std::string preamble;
 		reshadefx::module module;
-		size_t source_hash = 0;
+		uint64_t source_hash = 0;
 		std::filesystem::path source_file;
+		std::string dependencies;
 		std::vector<std::filesystem::path> included_files;
 		std::vector<std::pair<std::string, std::string>> definitions;
 		std::unordered_map<std::string, std::string> assembly;
 		std::vector<uniform> uniforms;
 		std::vector<unsigned char> uniform_data_storage;
+		size_t uniform_data_dirty_begin = 0;
+		size_t uniform_data_dirty_end = 0;
+
+		/// <summary>
+		/// Extends the range of uniform data that changed since it was last uploaded to the constant buffer.
+		/// </summary>
+		void mark_uniform_data_dirty(size_t offset, size_t size)
+		{
+			if (uniform_data_dirty_begin == uniform_data_dirty_end)
+			{
+				uniform_data_dirty_begin = offset;
+				uniform_data_dirty_end = offset + size;
+			}
+			else
+			{
+				uniform_data_dirty_begin = std::min(uniform_data_dirty_begin, offset);
+				uniform_data_dirty_end = std::max(uniform_data_dirty_end, offset + size);
+			}
+		}
 
 		struct binding_data
 		{
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "task_pool.hpp"
+#include <cassert>
+#include <algorithm>
+
+// Keep track of which pool the current thread is a worker of, so that tasks submitted from within a task can be pushed to the queue of that worker
+static thread_local const reshade::task_pool *s_current_pool = nullptr;
+static thread_local size_t s_current_worker_index = 0;
+
+reshade::task_pool::task_pool(size_t num_threads)
+{
+	assert(num_threads != 0);
+
+	// Create all queues before starting any threads, since workers access the queues of all other workers when stealing
+	_workers.reserve(num_threads);
+	for (size_t i = 0; i < num_threads; ++i)
+		_workers.push_back(std::make_unique<worker>());
+
+	for (size_t i = 0; i < num_threads; ++i)
+		_workers[i]->thread = std::thread(&task_pool::worker_main, this, i);
+}
+reshade::task_pool::~task_pool()
+{
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+		_shutdown = true;
+	}
+
+	_task_available.notify_all();
+
+	// Workers only exit after their queues were drained, so all remaining tasks still run to completion
+	for (const std::unique_ptr<worker> &worker : _workers)
+		worker->thread.join();
+}
+
+void reshade::task_pool::submit(std::function<void()> task)
+{
+	_num_pending_tasks++;
+
+	if (s_current_pool == this)
+	{
+		// Run task next on the current worker, since it likely follows up on the data the current task just worked on
+		worker &current_worker = *_workers[s_current_worker_index];
+		const std::lock_guard<std::mutex> lock(current_worker.mutex);
+		current_worker.tasks.push_front(std::move(task));
+		_num_queued_tasks++;
+	}
+	else
+	{
+		worker &next_worker = *_workers[_next_worker_index++ % _workers.size()];
+		const std::lock_guard<std::mutex> lock(next_worker.mutex);
+		next_worker.tasks.push_back(std::move(task));
+		_num_queued_tasks++;
+	}
+
+	// Acquire lock before notifying, so that a worker cannot miss this task between checking the queued task count and going to sleep
+	{	const std::lock_guard<std::mutex> lock(_mutex);
+	}
+
+	_task_available.notify_one();
+}
+
+void reshade::task_pool::parallel_for(size_t count, const std::function<void(size_t)> &func)
+{
+	// State is shared with the helper tasks, since those may only start after this call already returned (in which case they do not touch anything else)
+	struct parallel_for_state
+	{
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::atomic<size_t> next_index = 0;
+		size_t num_active_helpers = 0;
+	};
+
+	const auto state = std::make_shared<parallel_for_state>();
+
+	const auto run = [&func, count](parallel_for_state &state) {
+		// Indices are handed out dynamically, so that every thread keeps working until all of them were taken
+		for (size_t index; (index = state.next_index++) < count;)
+			func(index);
+	};
+
+	for (size_t i = 1; i < std::min(count, _workers.size() + 1); ++i)
+		submit([state, run]() {
+			{	const std::lock_guard<std::mutex> lock(state->mutex);
+				state->num_active_helpers++;
+			}
+
+			run(*state);
+
+			const std::lock_guard<std::mutex> lock(state->mutex);
+			if (--state->num_active_helpers == 0)
+				state->finished.notify_one();
+		});
+
+	run(*state);
+
+	// Only wait for helpers that actually started working, not for those still queued behind other tasks (which avoids a dead lock when all workers are waiting on each other)
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&state]() { return state->num_active_helpers == 0; });
+}
+
+void reshade::task_pool::wait()
+{
+	assert(s_current_pool != this);
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_tasks_finished.wait(lock, [this]() { return _num_pending_tasks == 0; });
+}
+
+void reshade::task_pool::worker_main(size_t index)
+{
+	s_current_pool = this;
+	s_current_worker_index = index;
+
+	while (true)
+	{
+		if (std::function<void()> task;
+			pop_task(index, task))
+		{
+			task();
+
+			if (--_num_pending_tasks == 0)
+			{
+				{	const std::lock_guard<std::mutex> lock(_mutex);
+				}
+
+				_tasks_finished.notify_all();
+			}
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_task_available.wait(lock, [this]() { return _shutdown || _num_queued_tasks != 0; });
+
+		if (_shutdown && _num_queued_tasks == 0)
+			break;
+	}
+
+	s_current_pool = nullptr;
+}
+
+bool reshade::task_pool::pop_task(size_t index, std::function<void()> &task)
+{
+	// Start with the queue of this worker and then go through the queues of all others to steal work from them
+	for (size_t i = 0; i < _workers.size(); ++i)
+	{
+		worker &victim = *_workers[(index + i) % _workers.size()];
+		const std::lock_guard<std::mutex> lock(victim.mutex);
+
+		if (victim.tasks.empty())
+			continue;
+
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+
+		_num_queued_tasks--;
+		return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#pragma once
+
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace reshade
+{
+	/// <summary>
+	/// A persistent pool of worker threads executing submitted tasks.
+	/// Every worker has its own task queue and steals tasks from the other queues when it runs out of work, so that a few long running tasks do not leave the remaining workers idle.
+	/// </summary>
+	class task_pool
+	{
+	public:
+		explicit task_pool(size_t num_threads);
+		~task_pool();
+
+		/// <summary>
+		/// Returns the number of worker threads in this pool.
+		/// </summary>
+		size_t num_threads() const { return _workers.size(); }
+
+		/// <summary>
+		/// Schedules the specified <paramref name="task"/> for execution on one of the worker threads.
+		/// Tasks submitted from within another task of this pool are executed next by the same worker (unless stolen by another), others are distributed evenly across all workers.
+		/// </summary>
+		void submit(std::function<void()> task);
+
+		/// <summary>
+		/// Calls the specified <paramref name="func"/> for every index in the range [0, <paramref name="count"/>) in parallel and blocks until all calls have returned.
+		/// The calling thread participates in the work, so this may also be called from within a task of this pool.
+		/// </summary>
+		void parallel_for(size_t count, const std::function<void(size_t)> &func);
+
+		/// <summary>
+		/// Blocks until all submitted tasks (including those submitted by tasks while waiting) have finished executing.
+		/// This must not be called from within a task of this pool.
+		/// </summary>
+		void wait();
+
+	private:
+		struct worker
+		{
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+			std::thread thread;
+		};
+
+		void worker_main(size_t index);
+		bool pop_task(size_t index, std::function<void()> &task);
+
+		std::vector<std::unique_ptr<worker>> _workers;
+		std::mutex _mutex;
+		std::condition_variable _task_available;
+		std::condition_variable _tasks_finished;
+		std::atomic<size_t> _num_queued_tasks = 0;
+		std::atomic<size_t> _num_pending_tasks = 0;
+		std::atomic<size_t> _next_worker_index = 0;
+		bool _shutdown = false;
+	};
+}
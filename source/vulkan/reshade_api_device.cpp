@@ -174,6 +174,8 @@ bool reshade::vulkan::device_impl::check_capability(api::device_caps capability)
 	case api::device_caps::resolve_region:
 	case api::device_caps::copy_query_results:
 		return true;
+	case api::device_caps::concurrent_pipeline_creation:
+		return true;
 	default:
 		return false;
 	}
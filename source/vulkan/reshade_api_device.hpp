@@ -6,7 +6,7 @@
 #pragma once
 
 #include "addon_manager.hpp"
-#include "lockfree_table.hpp"
+#include "object_registry.hpp"
 #pragma warning(push)
 #pragma warning(disable: 4100 4127 4324 4703) // Disable a bunch of warnings thrown by VMA code
 #include <vk_mem_alloc.h>
@@ -188,8 +188,8 @@ namespace reshade::vulkan
 		VkPhysicalDeviceFeatures _enabled_features = {};
 
 		VmaAllocator _alloc = nullptr;
-		lockfree_table<uint64_t, resource_data, 4096> _resources;
-		lockfree_table<uint64_t, resource_view_data, 4096> _views;
+		object_registry<uint64_t, resource_data> _resources;
+		object_registry<uint64_t, resource_view_data> _views;
 
 #if RESHADE_ADDON
 		lockfree_table<VkRenderPass, render_pass_data, 4096> _render_pass_list;
@@ -6,6 +6,8 @@
 #include "dll_log.hpp"
 #include "runtime_vk.hpp"
 #include "runtime_objects.hpp"
+#include <unordered_map>
+#include <unordered_set>
 
 static inline void transition_layout(const VkLayerDispatchTable &vk, VkCommandBuffer cmd_list, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
 	const VkImageSubresourceRange &subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS })
@@ -420,15 +422,57 @@ bool reshade::vulkan::runtime_impl::capture_screenshot(uint8_t *buffer) const
 	return mapped_data != nullptr;
 }
 
-bool reshade::vulkan::runtime_impl::compile_effect(effect &effect, api::shader_stage, const std::string &entry_point, std::vector<char> &out)
+bool reshade::vulkan::runtime_impl::compile_effect(const effect &effect, api::shader_stage, const std::string &entry_point, std::vector<char> &out, std::string &, std::string &)
 {
 	// There are various issues with SPIR-V modules that have multiple entry points on all major GPU vendors.
 	// On AMD for instance creating a graphics pipeline just fails with a generic VK_ERROR_OUT_OF_HOST_MEMORY. On NVIDIA artifacts occur on some driver versions.
-	// To work around these problems, create a separate shader module for every entry point and rewrite the SPIR-V module for each to removes all but a single entry point (and associated functions/variables).
+	// To work around these problems, create a separate shader module for every entry point and rewrite the SPIR-V module for each to remove all but a single entry point (and all functions/variables it does not reference).
 	uint32_t current_function = 0, current_function_offset = 0;
 	std::vector<uint32_t> spirv = effect.module.spirv;
 	std::vector<uint32_t> functions_to_remove, variables_to_remove;
 
+	// Find all functions that are reachable from the matching entry point, so that every other function can be removed as well
+	uint32_t entry_point_function = 0;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> function_calls;
+
+	for (uint32_t inst = 5 /* Skip SPIR-V header information */; inst < spirv.size();)
+	{
+		const uint32_t op = spirv[inst] & 0xFFFF;
+		const uint32_t len = (spirv[inst] >> 16) & 0xFFFF;
+		assert(len != 0);
+
+		switch (op)
+		{
+		case 15: // OpEntryPoint
+			if (entry_point == reinterpret_cast<const char *>(&spirv[inst + 3]))
+				entry_point_function = spirv[inst + 2];
+			break;
+		case 54: // OpFunction
+			current_function = spirv[inst + 2];
+			function_calls[current_function];
+			break;
+		case 57: // OpFunctionCall
+			function_calls[current_function].push_back(spirv[inst + 3]);
+			break;
+		}
+
+		inst += len;
+	}
+
+	std::unordered_set<uint32_t> reachable_functions;
+	for (std::vector<uint32_t> worklist = { entry_point_function }; !worklist.empty();)
+	{
+		const uint32_t function = worklist.back();
+		worklist.pop_back();
+
+		if (reachable_functions.insert(function).second)
+			worklist.insert(worklist.end(), function_calls[function].begin(), function_calls[function].end());
+	}
+
+	for (const auto &[function, calls] : function_calls)
+		if (reachable_functions.find(function) == reachable_functions.end())
+			functions_to_remove.push_back(function);
+
 	for (uint32_t inst = 5 /* Skip SPIR-V header information */; inst < spirv.size();)
 	{
 		const uint32_t op = spirv[inst] & 0xFFFF;
@@ -441,8 +485,6 @@ bool reshade::vulkan::runtime_impl::compile_effect(effect &effect, api::shader_s
 			// Look for any non-matching entry points
 			if (entry_point != reinterpret_cast<const char *>(&spirv[inst + 3]))
 			{
-				functions_to_remove.push_back(spirv[inst + 2]);
-
 				// Get interface variables
 				for (size_t k = inst + 3 + ((strlen(reinterpret_cast<const char *>(&spirv[inst + 3])) + 4) / 4); k < inst + len; ++k)
 					variables_to_remove.push_back(spirv[k]);
@@ -493,6 +535,33 @@ bool reshade::vulkan::runtime_impl::compile_effect(effect &effect, api::shader_s
 		inst += len;
 	}
 
+	// Remove debug names and decorations of everything that was removed above
+	std::unordered_set<uint32_t> used_ids;
+	for (uint32_t inst = 5 /* Skip SPIR-V header information */; inst < spirv.size();)
+	{
+		const uint32_t op = spirv[inst] & 0xFFFF;
+		const uint32_t len = (spirv[inst] >> 16) & 0xFFFF;
+
+		if (op != 5 /* OpName */ && op != 6 /* OpMemberName */ && op != 71 /* OpDecorate */ && op != 72 /* OpMemberDecorate */)
+			used_ids.insert(spirv.begin() + inst + 1, spirv.begin() + inst + len);
+
+		inst += len;
+	}
+
+	for (uint32_t inst = 5 /* Skip SPIR-V header information */; inst < spirv.size();)
+	{
+		const uint32_t op = spirv[inst] & 0xFFFF;
+		const uint32_t len = (spirv[inst] >> 16) & 0xFFFF;
+
+		if ((op == 5 /* OpName */ || op == 71 /* OpDecorate */) && used_ids.find(spirv[inst + 1]) == used_ids.end())
+		{
+			spirv.erase(spirv.begin() + inst, spirv.begin() + inst + len);
+			continue;
+		}
+
+		inst += len;
+	}
+
 	out.resize(spirv.size() * sizeof(uint32_t));
 	std::memcpy(out.data(), spirv.data(), out.size());
 	return true;
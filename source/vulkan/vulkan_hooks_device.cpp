@@ -1718,7 +1718,7 @@ void     VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const Vk
 
 			if (renderpass_data.cleared_attachments[i].index != renderpass_data_subpass.depth_stencil_attachment.attachment)
 			{
-				if (!reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_render_target_views)].empty())
+				if (reshade::has_addon_event<reshade::addon_event::clear_render_target_views>())
 				{
 					reshade::api::resource image = { 0 };
 					device_impl->get_resource_from_view(attachments[renderpass_data.cleared_attachments[i].index], &image);
@@ -1744,7 +1744,7 @@ void     VKAPI_CALL vkCmdBeginRenderPass(VkCommandBuffer commandBuffer, const Vk
 			}
 			else
 			{
-				if (!reshade::addon::event_list[static_cast<uint32_t>(reshade::addon_event::clear_depth_stencil_view)].empty())
+				if (reshade::has_addon_event<reshade::addon_event::clear_depth_stencil_view>())
 				{
 					reshade::api::resource image = { 0 };
 					device_impl->get_resource_from_view(attachments[renderpass_data.cleared_attachments[i].index], &image);
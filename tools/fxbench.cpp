@@ -0,0 +1,395 @@
+/**
+ * Copyright (C) 2021 Patrick Mours. All rights reserved.
+ * License: https://github.com/crosire/reshade#license
+ */
+
+#include "effect_parser.hpp"
+#include "effect_codegen.hpp"
+#include "effect_preprocessor.hpp"
+#include "version.h"
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+// Replace the global allocation functions to count every allocation made by the compiler
+// Each allocation is prefixed with a header containing its size, so that the number of bytes still alive (and the peak of that) can be tracked as well
+
+struct allocation_header
+{
+	void *base;
+	size_t size;
+};
+
+static std::atomic<size_t> s_num_allocations = 0;
+static std::atomic<size_t> s_allocated_bytes = 0;
+static std::atomic<size_t> s_live_bytes = 0;
+static std::atomic<size_t> s_peak_live_bytes = 0;
+
+static void *tracked_alloc(size_t size, size_t alignment)
+{
+	void *const base = std::malloc(size + alignment + sizeof(allocation_header));
+	if (base == nullptr)
+		throw std::bad_alloc();
+
+	const uintptr_t address = (reinterpret_cast<uintptr_t>(base) + sizeof(allocation_header) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+	allocation_header *const header = reinterpret_cast<allocation_header *>(address) - 1;
+	header->base = base;
+	header->size = size;
+
+	s_num_allocations.fetch_add(1, std::memory_order_relaxed);
+	s_allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+
+	const size_t live_bytes = s_live_bytes.fetch_add(size, std::memory_order_relaxed) + size;
+	for (size_t peak = s_peak_live_bytes.load(std::memory_order_relaxed); live_bytes > peak && !s_peak_live_bytes.compare_exchange_weak(peak, live_bytes, std::memory_order_relaxed);)
+		continue;
+
+	return reinterpret_cast<void *>(address);
+}
+static void tracked_free(void *ptr)
+{
+	if (ptr == nullptr)
+		return;
+
+	const allocation_header *const header = static_cast<allocation_header *>(ptr) - 1;
+	s_live_bytes.fetch_sub(header->size, std::memory_order_relaxed);
+
+	std::free(header->base);
+}
+
+void *operator new(size_t size) { return tracked_alloc(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__); }
+void *operator new(size_t size, std::align_val_t alignment) { return tracked_alloc(size, std::max(static_cast<size_t>(alignment), alignof(allocation_header))); }
+void operator delete(void *ptr) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept { tracked_free(ptr); }
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept { tracked_free(ptr); }
+
+static void print_usage(const char *path)
+{
+	printf(R"(usage: %s [options] <filename or directory> [...]
+
+Runs every effect file through the preprocessor, the parser and each code generator and reports wall time and memory usage of every phase as JSON.
+Directories are searched recursively for .fx files.
+
+Options:
+  -h, --help                Print this help.
+  --version                 Print ReShade version.
+
+  -D <id>=<text>            Define a preprocessor macro.
+  -I <path>                 Add directory to include search path.
+  -o <file>                 Write results to the given file instead of standard output.
+  -n <count>                Number of times each effect is compiled. Defaults to 10.
+	)", path);
+}
+
+struct phase_result
+{
+	std::string name;
+	std::vector<double> times;
+	size_t allocations = 0;
+	size_t allocated_bytes = 0;
+	size_t peak_bytes = 0;
+};
+
+/// <summary>
+/// Measures the time and allocations of a single phase, accumulating the results into <paramref name="result"/>.
+/// </summary>
+class phase_timer
+{
+public:
+	explicit phase_timer(phase_result &result) :
+		_result(result),
+		_start_allocations(s_num_allocations),
+		_start_allocated_bytes(s_allocated_bytes),
+		_start_live_bytes(s_live_bytes)
+	{
+		s_peak_live_bytes = _start_live_bytes;
+		_start_time = std::chrono::high_resolution_clock::now();
+	}
+	~phase_timer()
+	{
+		const auto end_time = std::chrono::high_resolution_clock::now();
+
+		_result.times.push_back(std::chrono::duration<double, std::milli>(end_time - _start_time).count());
+
+		// Allocations are the same on every iteration, except for the first one, which fills caches that persist across iterations, so report the maximum
+		_result.allocations = std::max(_result.allocations, s_num_allocations - _start_allocations);
+		_result.allocated_bytes = std::max(_result.allocated_bytes, s_allocated_bytes - _start_allocated_bytes);
+		_result.peak_bytes = std::max(_result.peak_bytes, s_peak_live_bytes - _start_live_bytes);
+	}
+
+private:
+	phase_result &_result;
+	size_t _start_allocations;
+	size_t _start_allocated_bytes;
+	size_t _start_live_bytes;
+	std::chrono::high_resolution_clock::time_point _start_time;
+};
+
+static std::string path_to_utf8(const std::filesystem::path &path)
+{
+	// The result of 'u8string' is a 'std::u8string' since C++20, so copy its bytes over explicitly
+	const auto value = path.u8string();
+	return std::string(reinterpret_cast<const char *>(value.data()), value.size());
+}
+
+static std::string escape_json_string(const std::string &value)
+{
+	std::string result;
+	result.reserve(value.size() + 2);
+	result += '\"';
+	for (const char c : value)
+	{
+		if (c == '\"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	result += '\"';
+	return result;
+}
+
+/// <summary>
+/// Times and memory usage of a phase, either of a single effect or summed up across all effects.
+/// </summary>
+struct phase_summary
+{
+	std::string name;
+	double first_ms = 0;
+	double min_ms = 0;
+	double median_ms = 0;
+	size_t allocations = 0;
+	size_t allocated_bytes = 0;
+	size_t peak_bytes = 0;
+
+	explicit phase_summary(const phase_result &phase) :
+		name(phase.name),
+		allocations(phase.allocations),
+		allocated_bytes(phase.allocated_bytes),
+		peak_bytes(phase.peak_bytes)
+	{
+		if (phase.times.empty())
+			return;
+
+		std::vector<double> times = phase.times;
+		std::sort(times.begin(), times.end());
+
+		first_ms = phase.times.front();
+		min_ms = times.front();
+		median_ms = times[times.size() / 2];
+	}
+
+	phase_summary &operator+=(const phase_summary &other)
+	{
+		first_ms += other.first_ms;
+		min_ms += other.min_ms;
+		median_ms += other.median_ms;
+		allocations += other.allocations;
+		allocated_bytes += other.allocated_bytes;
+		peak_bytes = std::max(peak_bytes, other.peak_bytes);
+		return *this;
+	}
+
+	void write_json(std::ostream &out) const
+	{
+		out << "{ \"name\": " << escape_json_string(name)
+			<< ", \"first_ms\": " << first_ms
+			<< ", \"min_ms\": " << min_ms
+			<< ", \"median_ms\": " << median_ms
+			<< ", \"allocations\": " << allocations
+			<< ", \"allocated_bytes\": " << allocated_bytes
+			<< ", \"peak_bytes\": " << peak_bytes << " }";
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	const char *output_file = nullptr;
+	size_t num_iterations = 10;
+	std::vector<std::filesystem::path> effect_files;
+	std::vector<std::filesystem::path> include_paths;
+	std::vector<std::pair<std::string, std::string>> macros;
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		if (const char *arg = argv[i]; arg[0] == '-')
+		{
+			if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+			{
+				print_usage(argv[0]);
+				return 0;
+			}
+			if (0 == std::strcmp(arg, "--version"))
+			{
+				printf("%s\n", VERSION_STRING_PRODUCT);
+				return 0;
+			}
+
+			if (i + 1 >= argc)
+				continue;
+			else if (0 == std::strcmp(arg, "-D"))
+			{
+				const std::string macro = argv[++i];
+				const size_t value = macro.find('=');
+				macros.emplace_back(macro.substr(0, value), value != std::string::npos ? macro.substr(value + 1) : "1");
+			}
+			else if (0 == std::strcmp(arg, "-I"))
+				include_paths.push_back(std::filesystem::path(argv[++i]));
+			else if (0 == std::strcmp(arg, "-o"))
+				output_file = argv[++i];
+			else if (0 == std::strcmp(arg, "-n"))
+				num_iterations = std::max(1l, std::strtol(argv[++i], nullptr, 10));
+		}
+		else
+		{
+			const std::filesystem::path path(arg);
+
+			if (std::error_code ec; std::filesystem::is_directory(path, ec))
+			{
+				for (const std::filesystem::directory_entry &entry : std::filesystem::recursive_directory_iterator(path, std::filesystem::directory_options::skip_permission_denied, ec))
+					if (entry.path().extension() == ".fx")
+						effect_files.push_back(entry.path());
+			}
+			else
+			{
+				effect_files.push_back(path);
+			}
+		}
+	}
+
+	if (effect_files.empty())
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	// Sort files so that results are always reported in the same order
+	std::sort(effect_files.begin(), effect_files.end());
+
+	struct backend_info
+	{
+		const char *name;
+		reshadefx::codegen *(*create)();
+	};
+
+	const backend_info backends[] = {
+		{ "hlsl", []() { return reshadefx::create_codegen_hlsl(50, false, false); } },
+		{ "glsl", []() { return reshadefx::create_codegen_glsl(false, false); } },
+		{ "spirv", []() { return reshadefx::create_codegen_spirv(true, false, false, false); } },
+	};
+
+	std::ostringstream json;
+	json << "{\n\t\"version\": " << escape_json_string(VERSION_STRING_PRODUCT) << ",\n\t\"iterations\": " << num_iterations << ",\n\t\"effects\": [\n";
+
+	std::vector<phase_summary> totals;
+	bool success = true;
+
+	for (size_t effect_index = 0; effect_index < effect_files.size(); ++effect_index)
+	{
+		const std::filesystem::path &effect_file = effect_files[effect_index];
+
+		// Phases are "preprocess", followed by "parse_<backend>" (which includes code generation, since the parser emits code directly) and "write_<backend>" for every backend
+		std::vector<phase_result> phases(1 + std::size(backends) * 2);
+		phases[0].name = "preprocess";
+		for (size_t k = 0; k < std::size(backends); ++k)
+		{
+			phases[1 + k * 2 + 0].name = std::string("parse_") + backends[k].name;
+			phases[1 + k * 2 + 1].name = std::string("write_") + backends[k].name;
+		}
+
+		std::string errors;
+
+		for (size_t iteration = 0; iteration < num_iterations && errors.empty(); ++iteration)
+		{
+			reshadefx::preprocessor pp;
+			pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+			pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+			pp.add_macro_definition("BUFFER_WIDTH", "800");
+			pp.add_macro_definition("BUFFER_HEIGHT", "600");
+			pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
+			pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
+
+			for (const auto &[name, value] : macros)
+				pp.add_macro_definition(name, value);
+			for (const std::filesystem::path &include_path : include_paths)
+				pp.add_include_path(include_path);
+
+			bool preprocessed;
+			{	phase_timer timer(phases[0]);
+				preprocessed = pp.append_file(effect_file);
+			}
+
+			if (!preprocessed)
+			{
+				errors = pp.errors();
+				break;
+			}
+
+			for (size_t k = 0; k < std::size(backends); ++k)
+			{
+				std::unique_ptr<reshadefx::codegen> backend(backends[k].create());
+
+				reshadefx::parser parser;
+				bool parsed;
+				{	phase_timer timer(phases[1 + k * 2 + 0]);
+					parsed = parser.parse(pp.output(), backend.get());
+				}
+
+				if (!parsed)
+				{
+					errors = parser.errors();
+					break;
+				}
+
+				reshadefx::module module;
+				{	phase_timer timer(phases[1 + k * 2 + 1]);
+					backend->write_result(module);
+				}
+			}
+		}
+
+		if (!errors.empty())
+		{
+			std::cerr << path_to_utf8(effect_file) << ": failed to compile:\n" << errors << std::endl;
+			success = false;
+		}
+
+		json << "\t\t{\n\t\t\t\"file\": " << escape_json_string(path_to_utf8(effect_file)) << ",\n\t\t\t\"success\": " << (errors.empty() ? "true" : "false") << ",\n\t\t\t\"phases\": [\n";
+		for (size_t k = 0; k < phases.size(); ++k)
+		{
+			const phase_summary summary(phases[k]);
+			json << "\t\t\t\t";
+			summary.write_json(json);
+			json << (k + 1 < phases.size() ? ",\n" : "\n");
+
+			// Sum up every phase across all effects (the peak memory usage is the maximum instead)
+			if (totals.size() <= k)
+				totals.push_back(summary);
+			else
+				totals[k] += summary;
+		}
+		json << "\t\t\t]\n\t\t}" << (effect_index + 1 < effect_files.size() ? ",\n" : "\n");
+	}
+
+	json << "\t],\n\t\"totals\": [\n";
+	for (size_t k = 0; k < totals.size(); ++k)
+	{
+		json << "\t\t";
+		totals[k].write_json(json);
+		json << (k + 1 < totals.size() ? ",\n" : "\n");
+	}
+	json << "\t]\n}\n";
+
+	if (output_file != nullptr)
+		std::ofstream(output_file) << json.str();
+	else
+		std::cout << json.str();
+
+	return success ? 0 : 1;
+}
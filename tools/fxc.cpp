@@ -6,15 +6,23 @@
 #include "effect_parser.hpp"
 #include "effect_codegen.hpp"
 #include "effect_preprocessor.hpp"
+#include "task_pool.hpp"
 #include "version.h"
+#include <mutex>
+#include <atomic>
+#include <cctype>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <iostream>
+#include <algorithm>
+#include <filesystem>
 
 static void print_usage(const char *path)
 {
 	printf(R"(usage: %s [options] <filename>
+       %s --batch <manifest> [options]
+       %s --daemon [options]
 
 Options:
   -h, --help                Print this help.
@@ -24,7 +32,7 @@ Options:
   -I <path>                 Add directory to include search path.
   -P <path>                 Pre-process to file. If <path> is "-", then result is written to standard output instead.
 
-  -Fo <file>                Output SPIR-V binary to the given file.
+  -Fo <file>                Output SPIR-V binary (or GLSL/HLSL code) to the given file.
   -Fe <file>                Output warnings and errors to the given file.
 
   --glsl                    Print GLSL code for the previously specified entry point.
@@ -37,156 +45,409 @@ Options:
   --spec-constants          Convert uniform variables to specialization constants.
 
   -Zi                       Enable debug information.
-	)", path);
+
+Batch and daemon mode:
+  --batch <manifest>        Compile every combination of effect, macro set and backend listed in the manifest file.
+                            Each line of the manifest is one of:
+                              effect <filename>
+                              defines <name> [-D <id>=<text> ...]
+                              backend <name> [--glsl | --hlsl] [options]
+                            Results are written to "<output dir>/<effect>.<defines name>.<backend name>.<spv|glsl|hlsl>".
+  --output-dir <path>       Directory batch results are written to. Defaults to the current directory.
+  --daemon                  Read compile requests from standard input until it is closed.
+                            Each request is a single line of the form "<id> [options] <filename>" and is answered with a
+                            line "<id> ok|failed <size>", followed by <size> bytes of printed code and error messages.
+  -j <count>                Number of threads used to compile in batch and daemon mode. Defaults to the number of cores.
+
+Options specified in addition to --batch or --daemon apply to all compilations (e.g. include paths).
+	)", path, path, path);
 }
 
-int main(int argc, char *argv[])
+struct compile_options
 {
-	const char *filename = nullptr;
-	const char *preprocess = nullptr;
-	const char *errorfile = nullptr;
-	const char *objectfile = nullptr;
-	const char *buffer_width = "800";
-	const char *buffer_height = "600";
+	std::string filename;
+	std::string preprocess;
+	std::string errorfile;
+	std::string objectfile;
+	std::string buffer_width = "800";
+	std::string buffer_height = "600";
+	std::vector<std::pair<std::string, std::string>> macros;
+	std::vector<std::string> include_paths;
 	bool print_glsl = false;
 	bool print_hlsl = false;
 	bool debug_info = false;
 	bool invert_y_axis = false;
 	bool spec_constants = false;
 	unsigned int shader_model = 50;
+};
 
-	reshadefx::parser parser;
-	reshadefx::preprocessor pp;
-	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
-	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
+/// <summary>
+/// Splits a line into separate arguments at whitespace, keeping text in double quotes together.
+/// </summary>
+static std::vector<std::string> split_arguments(const std::string &line)
+{
+	std::vector<std::string> args;
 
-	// Parse command-line arguments
-	for (int i = 1; i < argc; ++i)
+	for (size_t i = 0; i < line.size();)
 	{
-		if (const char *arg = argv[i]; arg[0] == '-')
+		if (std::isspace(static_cast<unsigned char>(line[i])))
 		{
-			if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
-			{
-				print_usage(argv[0]);
-				return 0;
-			}
-			if (0 == std::strcmp(arg, "--version"))
-			{
-				printf("%s\n", VERSION_STRING_PRODUCT);
-				return 0;
-			}
+			i++;
+			continue;
+		}
 
-			if (0 == std::strcmp(arg, "-D"))
-			{
-				char *macro = argv[++i];
-				char *value = std::strchr(macro, '=');
-				if (value) *value++ = '\0';
-				pp.add_macro_definition(macro, value ? value : "1");
-				continue;
-			}
+		std::string &arg = args.emplace_back();
+		for (bool quoted = false; i < line.size() && (quoted || !std::isspace(static_cast<unsigned char>(line[i]))); ++i)
+		{
+			if (line[i] == '\"')
+				quoted = !quoted;
+			else
+				arg += line[i];
+		}
+	}
 
-			if (0 == std::strcmp(arg, "-I"))
-			{
-				pp.add_include_path(argv[++i]);
-				continue;
-			}
+	return args;
+}
+
+/// <summary>
+/// Parses the specified command-line arguments into <paramref name="options"/>.
+/// </summary>
+/// <returns><see langword="false"/> if the arguments were invalid, in which case <paramref name="errors"/> contains the reason.</returns>
+static bool parse_arguments(const std::vector<std::string> &args, compile_options &options, std::string &errors)
+{
+	for (size_t i = 0; i < args.size(); ++i)
+	{
+		if (const std::string &arg = args[i]; arg[0] == '-')
+		{
+			if (arg == "-Zi")
+				options.debug_info = true;
+			else if (arg == "--glsl")
+				options.print_glsl = true;
+			else if (arg == "--hlsl")
+				options.print_hlsl = true;
+			else if (arg == "--invert-y")
+				options.invert_y_axis = true;
+			else if (arg == "--spec-constants")
+				options.spec_constants = true;
 
-			if (0 == std::strcmp(arg, "-Zi"))
-				debug_info = true;
-			else if (0 == std::strcmp(arg, "--glsl"))
-				print_glsl = true;
-			else if (0 == std::strcmp(arg, "--hlsl"))
-				print_hlsl = true;
-			else if (0 == std::strcmp(arg, "--invert-y"))
-				invert_y_axis = true;
-			else if (0 == std::strcmp(arg, "--spec-constants"))
-				spec_constants = true;
-
-			if (i + 1 >= argc)
+			if (i + 1 >= args.size())
 				continue;
-			else if (0 == std::strcmp(arg, "-P"))
-				preprocess = argv[++i];
-			else if (0 == std::strcmp(arg, "-Fe"))
-				errorfile = argv[++i];
-			else if (0 == std::strcmp(arg, "-Fo"))
-				objectfile = argv[++i];
-			else if (0 == std::strcmp(arg, "--shader-model"))
-				shader_model = std::strtol(argv[++i], nullptr, 10);
-			else if (0 == std::strcmp(arg, "--width"))
-				buffer_width = argv[++i];
-			else if (0 == std::strcmp(arg, "--height"))
-				buffer_height = argv[++i];
+			else if (arg == "-D")
+			{
+				const std::string &macro = args[++i];
+				const size_t value = macro.find('=');
+				options.macros.emplace_back(macro.substr(0, value), value != std::string::npos ? macro.substr(value + 1) : "1");
+			}
+			else if (arg == "-I")
+				options.include_paths.push_back(args[++i]);
+			else if (arg == "-P")
+				options.preprocess = args[++i];
+			else if (arg == "-Fe")
+				options.errorfile = args[++i];
+			else if (arg == "-Fo")
+				options.objectfile = args[++i];
+			else if (arg == "--shader-model")
+				options.shader_model = std::strtol(args[++i].c_str(), nullptr, 10);
+			else if (arg == "--width")
+				options.buffer_width = args[++i];
+			else if (arg == "--height")
+				options.buffer_height = args[++i];
 		}
 		else
 		{
-			if (filename != nullptr)
+			if (!options.filename.empty())
 			{
-				std::cout << "error: More than one input file specified" << std::endl;
-				return 1;
+				errors = "error: More than one input file specified";
+				return false;
 			}
 
-			filename = arg;
+			options.filename = arg;
 		}
 	}
 
-	if (filename == nullptr)
-	{
-		print_usage(argv[0]);
-		return 1;
-	}
+	return true;
+}
+
+/// <summary>
+/// Pre-processes and compiles a single effect file.
+/// Included files are cached across all calls, so subsequent compilations that include the same headers are faster.
+/// </summary>
+/// <param name="options">The options to compile with.</param>
+/// <param name="output">Receives the code to print to standard output (unless it was written to a file).</param>
+/// <param name="errors">Receives the warning and error messages (unless they were written to a file).</param>
+/// <returns><see langword="true"/> if compilation was successful, <see langword="false"/> otherwise.</returns>
+static bool compile(const compile_options &options, std::string &output, std::string &errors)
+{
+	reshadefx::parser parser;
+	reshadefx::preprocessor pp;
+	pp.add_macro_definition("__RESHADE__", std::to_string(VERSION_MAJOR * 10000 + VERSION_MINOR * 100 + VERSION_REVISION));
+	pp.add_macro_definition("__RESHADE_PERFORMANCE_MODE__", "0");
 
-	pp.add_macro_definition("BUFFER_WIDTH", buffer_width);
-	pp.add_macro_definition("BUFFER_HEIGHT", buffer_height);
+	for (const auto &[name, value] : options.macros)
+		pp.add_macro_definition(name, value);
+	for (const std::string &include_path : options.include_paths)
+		pp.add_include_path(include_path);
+
+	pp.add_macro_definition("BUFFER_WIDTH", options.buffer_width);
+	pp.add_macro_definition("BUFFER_HEIGHT", options.buffer_height);
 	pp.add_macro_definition("BUFFER_RCP_WIDTH", "(1.0 / BUFFER_WIDTH)");
 	pp.add_macro_definition("BUFFER_RCP_HEIGHT", "(1.0 / BUFFER_HEIGHT)");
 
-	if (!pp.append_file(filename))
+	if (!pp.append_file(options.filename))
 	{
-		if (errorfile == nullptr)
-			std::cout << pp.errors() << std::endl;
+		if (options.errorfile.empty())
+			errors = pp.errors();
 		else
-			std::ofstream(errorfile) << pp.errors();
-		return 1;
+			std::ofstream(options.errorfile) << pp.errors();
+		return false;
 	}
 
-	if (preprocess != nullptr)
+	if (!options.preprocess.empty())
 	{
-		if (std::strcmp(preprocess, "-") == 0)
-			std::cout << pp.output() << std::endl;
+		if (options.preprocess == "-")
+			output = std::move(pp.output());
 		else
-			std::ofstream(preprocess) << pp.output();
-		return 0;
+			std::ofstream(options.preprocess) << pp.output();
+		return true;
 	}
 
 	std::unique_ptr<reshadefx::codegen> backend;
-	if (print_glsl)
-		backend.reset(reshadefx::create_codegen_glsl(debug_info, spec_constants));
-	else if (print_hlsl)
-		backend.reset(reshadefx::create_codegen_hlsl(shader_model, debug_info, spec_constants));
+	if (options.print_glsl)
+		backend.reset(reshadefx::create_codegen_glsl(options.debug_info, options.spec_constants));
+	else if (options.print_hlsl)
+		backend.reset(reshadefx::create_codegen_hlsl(options.shader_model, options.debug_info, options.spec_constants));
 	else
-		backend.reset(reshadefx::create_codegen_spirv(true, debug_info, spec_constants, invert_y_axis));
+		backend.reset(reshadefx::create_codegen_spirv(true, options.debug_info, options.spec_constants, options.invert_y_axis));
 
 	if (!parser.parse(pp.output(), backend.get()))
 	{
-		if (errorfile == nullptr)
-			std::cout << pp.errors() << parser.errors() << std::endl;
+		if (options.errorfile.empty())
+			errors = pp.errors() + parser.errors();
 		else
-			std::ofstream(errorfile) << pp.errors() << parser.errors();
-		return 1;
+			std::ofstream(options.errorfile) << pp.errors() << parser.errors();
+		return false;
 	}
 
 	reshadefx::module module;
 	backend->write_result(module);
 
-	if (print_glsl || print_hlsl)
+	if (options.print_glsl || options.print_hlsl)
 	{
-		std::cout << module.hlsl << std::endl;
+		if (options.objectfile.empty())
+			output = std::move(module.hlsl);
+		else
+			std::ofstream(options.objectfile) << module.hlsl;
 	}
-	else if (objectfile != nullptr)
+	else if (!options.objectfile.empty())
 	{
-		std::ofstream(objectfile, std::ios::binary).write(
+		std::ofstream(options.objectfile, std::ios::binary).write(
 			reinterpret_cast<const char *>(module.spirv.data()), module.spirv.size() * sizeof(uint32_t));
 	}
 
+	return true;
+}
+
+static int run_batch(const std::string &manifest_path, const std::filesystem::path &output_dir, const compile_options &base_options, size_t num_threads)
+{
+	std::ifstream manifest(manifest_path);
+	if (!manifest)
+	{
+		std::cout << "error: Could not open manifest file " << manifest_path << std::endl;
+		return 1;
+	}
+
+	struct named_arguments
+	{
+		std::string name;
+		std::vector<std::string> args;
+	};
+
+	std::vector<std::string> effects;
+	std::vector<named_arguments> defines, backends;
+
+	size_t line_number = 0;
+	for (std::string line; std::getline(manifest, line);)
+	{
+		line_number++;
+
+		std::vector<std::string> args = split_arguments(line);
+		if (args.empty() || args[0][0] == '#')
+			continue;
+
+		if (args[0] == "effect" && args.size() == 2)
+			effects.push_back(args[1]);
+		else if (args[0] == "defines" && args.size() >= 2)
+			defines.push_back({ args[1], std::vector<std::string>(args.begin() + 2, args.end()) });
+		else if (args[0] == "backend" && args.size() >= 2)
+			backends.push_back({ args[1], std::vector<std::string>(args.begin() + 2, args.end()) });
+		else
+		{
+			std::cout << manifest_path << '(' << line_number << "): error: Invalid manifest entry" << std::endl;
+			return 1;
+		}
+	}
+
+	// A manifest without macro sets or backends compiles every effect once with the base options
+	if (defines.empty())
+		defines.push_back({});
+	if (backends.empty())
+		backends.push_back({});
+
+	struct job
+	{
+		std::string description;
+		compile_options options;
+	};
+
+	std::vector<job> jobs;
+	jobs.reserve(effects.size() * defines.size() * backends.size());
+
+	for (const std::string &effect : effects)
+	{
+		for (const named_arguments &macro_set : defines)
+		{
+			for (const named_arguments &backend : backends)
+			{
+				job &job = jobs.emplace_back();
+				job.options = base_options;
+				job.options.filename = effect;
+
+				std::string errors;
+				if (!parse_arguments(macro_set.args, job.options, errors) || !parse_arguments(backend.args, job.options, errors))
+				{
+					std::cout << manifest_path << ": " << errors << std::endl;
+					return 1;
+				}
+
+				std::string output_name = std::filesystem::path(effect).stem().string();
+				if (!macro_set.name.empty())
+					output_name += '.' + macro_set.name;
+				if (!backend.name.empty())
+					output_name += '.' + backend.name;
+				output_name += job.options.print_glsl ? ".glsl" : job.options.print_hlsl ? ".hlsl" : ".spv";
+
+				job.options.objectfile = (output_dir / output_name).string();
+				job.description = output_name;
+			}
+		}
+	}
+
+	std::error_code ec;
+	std::filesystem::create_directories(output_dir, ec);
+
+	std::mutex output_mutex;
+	std::atomic<size_t> num_failed = 0;
+
+	reshade::task_pool pool(num_threads);
+	pool.parallel_for(jobs.size(), [&](size_t i) {
+		std::string output, errors;
+		if (compile(jobs[i].options, output, errors))
+			return;
+
+		num_failed++;
+
+		const std::lock_guard<std::mutex> lock(output_mutex);
+		std::cout << jobs[i].description << ": failed:\n" << errors << std::endl;
+	});
+
+	std::cout << (jobs.size() - num_failed) << " of " << jobs.size() << " compilations succeeded" << std::endl;
+
+	return num_failed != 0 ? 1 : 0;
+}
+
+static int run_daemon(const compile_options &base_options, size_t num_threads)
+{
+	std::mutex output_mutex;
+	reshade::task_pool pool(num_threads);
+
+	// Requests are handled as soon as they arrive, so responses may be written in a different order than the requests were received (the identifier is used to match them)
+	for (std::string line; std::getline(std::cin, line);)
+	{
+		std::vector<std::string> args = split_arguments(line);
+		if (args.empty())
+			continue;
+
+		pool.submit([&output_mutex, &base_options, args = std::move(args)]() {
+			compile_options options = base_options;
+
+			std::string output, errors;
+			const bool success = parse_arguments(std::vector<std::string>(args.begin() + 1, args.end()), options, errors) && compile(options, output, errors);
+
+			output += errors;
+
+			const std::lock_guard<std::mutex> lock(output_mutex);
+			std::cout << args[0] << (success ? " ok " : " failed ") << output.size() << '\n' << output;
+			std::cout.flush();
+		});
+	}
+
+	pool.wait();
+
 	return 0;
 }
+
+int main(int argc, char *argv[])
+{
+	const char *batch_manifest = nullptr;
+	const char *output_dir = ".";
+	bool daemon = false;
+	size_t num_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	std::vector<std::string> args;
+
+	// Parse command-line arguments
+	for (int i = 1; i < argc; ++i)
+	{
+		const char *const arg = argv[i];
+
+		if (0 == std::strcmp(arg, "-h") || 0 == std::strcmp(arg, "--help"))
+		{
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (0 == std::strcmp(arg, "--version"))
+		{
+			printf("%s\n", VERSION_STRING_PRODUCT);
+			return 0;
+		}
+
+		if (0 == std::strcmp(arg, "--daemon"))
+			daemon = true;
+		else if (0 == std::strcmp(arg, "--batch") && i + 1 < argc)
+			batch_manifest = argv[++i];
+		else if (0 == std::strcmp(arg, "--output-dir") && i + 1 < argc)
+			output_dir = argv[++i];
+		else if (0 == std::strcmp(arg, "-j") && i + 1 < argc)
+			num_threads = std::max(1l, std::strtol(argv[++i], nullptr, 10));
+		else
+			args.push_back(arg);
+	}
+
+	compile_options options;
+	if (std::string errors; !parse_arguments(args, options, errors))
+	{
+		std::cout << errors << std::endl;
+		return 1;
+	}
+
+	if (batch_manifest != nullptr)
+		return run_batch(batch_manifest, output_dir, options, num_threads);
+	if (daemon)
+		return run_daemon(options, num_threads);
+
+	if (options.filename.empty())
+	{
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	std::string output, errors;
+	const bool success = compile(options, output, errors);
+
+	if (!success)
+		std::cout << errors << std::endl;
+	else if (!output.empty())
+		std::cout << output << std::endl;
+
+	return success ? 0 : 1;
+}